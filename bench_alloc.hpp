@@ -0,0 +1,98 @@
+#ifndef SJTU_BENCH_ALLOC_HPP
+#define SJTU_BENCH_ALLOC_HPP
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+/**
+ * allocation accounting for the backends.
+ *
+ * every backend allocates through SJTU_DEQUE_ALLOCATOR (std::allocator unless defined
+ * before the backend is included). defining it as ::bench::counting_allocator makes all
+ * of their buffers, chunks and nodes show up in bench::allocations().
+ */
+namespace bench {
+    struct alloc_counters {
+        long long live_bytes, peak_bytes;
+        long long allocs, frees;
+
+        void reset() {
+            live_bytes = peak_bytes = 0;
+            allocs = frees = 0;
+        }
+
+        // restart counting at a phase boundary, live bytes carry over
+        void restart_phase() {
+            peak_bytes = live_bytes;
+            allocs = frees = 0;
+        }
+    };
+
+    // allocation activity of one phase, see run_test7
+    struct alloc_sample {
+        long long allocs, frees;
+        long long peak_bytes, live_bytes;
+        long long elements;
+    };
+
+    inline alloc_counters &allocations() {
+        static alloc_counters counters = {0, 0, 0, 0};
+        return counters;
+    }
+
+    template<class U>
+    class counting_allocator {
+    public:
+        typedef U value_type;
+        typedef U *pointer;
+        typedef const U *const_pointer;
+        typedef U &reference;
+        typedef const U &const_reference;
+        typedef size_t size_type;
+        typedef ptrdiff_t difference_type;
+
+        template<class V>
+        struct rebind {
+            typedef counting_allocator<V> other;
+        };
+
+        counting_allocator() {}
+
+        template<class V>
+        counting_allocator(const counting_allocator<V> &) {}
+
+        U *allocate(size_t n) {
+            alloc_counters &c = allocations();
+            c.live_bytes += n * sizeof(U);
+            if (c.live_bytes > c.peak_bytes) c.peak_bytes = c.live_bytes;
+            ++c.allocs;
+            return static_cast<U *>(::operator new(n * sizeof(U)));
+        }
+
+        void deallocate(U *p, size_t n) {
+            alloc_counters &c = allocations();
+            c.live_bytes -= n * sizeof(U);
+            ++c.frees;
+            ::operator delete(p);
+        }
+
+        template<class V, class... Args>
+        void construct(V *p, Args &&... args) { ::new((void *) p) V(std::forward<Args>(args)...); }
+
+        template<class V>
+        void destroy(V *p) { p->~V(); }
+
+        template<class V>
+        bool operator==(const counting_allocator<V> &) const { return true; }
+
+        template<class V>
+        bool operator!=(const counting_allocator<V> &) const { return false; }
+    };
+}
+
+// defined here rather than next to the includes of the backends, so that chunk_pool.hpp,
+// pulled in by bench_phases.hpp as well, always sees it first
+#define SJTU_DEQUE_ALLOCATOR ::bench::counting_allocator
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef SJTU_BENCH_BACKENDS_HPP
+#define SJTU_BENCH_BACKENDS_HPP
+
+/**
+ * Pulls every deque implementation of this repo into one translation unit.
+ *
+ * All implementations share the SJTU_DEQUE_HPP guard and the name sjtu::deque,
+ * so each one is included with the guard reset and `sjtu` renamed to a
+ * namespace of its own. The renamed namespaces import the real sjtu namespace,
+ * so exceptions.hpp, utility.hpp, relocation.hpp, chunk_pool.hpp and chunk_scan.hpp are still found by
+ * unqualified lookup, and the chunk pools are shared by the backends that use them.
+ * Every backend allocates through bench::counting_allocator, see bench_alloc.hpp.
+ */
+
+#include "exceptions.hpp"
+#include "utility.hpp"
+#include "relocation.hpp"
+#include "chunk_scan.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include <list>
+#include <iostream>
+
+#include "bench_alloc.hpp"
+#include "chunk_pool.hpp"
+
+namespace sjtu_ring_buffer { using namespace sjtu; }
+namespace sjtu_linkedlist { using namespace sjtu; }
+namespace sjtu_vector_chunk { using namespace sjtu; }
+namespace sjtu_sqrt_vector { using namespace sjtu; }
+namespace sjtu_accepted_sqrt_vector { using namespace sjtu; }
+namespace sjtu_fenwick_tree_vector { using namespace sjtu; }
+
+#undef SJTU_DEQUE_HPP
+#define sjtu sjtu_ring_buffer
+#include "deque_ring_buffer.cpp"
+#undef sjtu
+
+#undef SJTU_DEQUE_HPP
+#define sjtu sjtu_linkedlist
+#include "deque_linkedlist.cpp"
+#undef sjtu
+
+#undef SJTU_DEQUE_HPP
+#define sjtu sjtu_vector_chunk
+#include "deque_vector_chunk.cpp"
+#undef sjtu
+
+#undef SJTU_DEQUE_HPP
+#define sjtu sjtu_sqrt_vector
+#include "deque_sqrt_vector.cpp"
+#undef sjtu
+
+#undef SJTU_DEQUE_HPP
+#define sjtu sjtu_accepted_sqrt_vector
+#include "deque_accepted_sqrt_vector_without_cache.hpp"
+#undef sjtu
+
+#undef SJTU_DEQUE_HPP
+#define sjtu sjtu_fenwick_tree_vector
+#include "deque_fenwick_tree_vector.hpp"
+#undef sjtu
+
+#undef SJTU_DEQUE_HPP
+
+namespace bench {
+    /**
+     * a tag type carrying one backend, use as
+     *   typename decltype(b)::template deque<T>
+     * inside the functor passed to for_each_backend.
+     * memcpy_relocation is set for backends that move elements around with memcpy / memmove.
+     */
+    template<template<class> class D>
+    struct backend {
+        template<class T> using deque = D<T>;
+        const char *name;
+        bool memcpy_relocation;
+    };
+
+    const char *const backend_names[] = {
+            "ring_buffer", "linkedlist", "vector_chunk", "sqrt_vector", "accepted_sqrt_vector", "fenwick_tree_vector"
+    };
+
+    const int backend_count = sizeof(backend_names) / sizeof(backend_names[0]);
+
+    template<typename Fn>
+    void for_each_backend(Fn &&fn) {
+        fn(backend<sjtu_ring_buffer::deque>{backend_names[0], true});
+        fn(backend<sjtu_linkedlist::deque>{backend_names[1], false});
+        fn(backend<sjtu_vector_chunk::deque>{backend_names[2], false});
+        fn(backend<sjtu_sqrt_vector::deque>{backend_names[3], false});
+        fn(backend<sjtu_accepted_sqrt_vector::deque>{backend_names[4], false});
+        fn(backend<sjtu_fenwick_tree_vector::deque>{backend_names[5], false});
+    }
+}
+
+#endif
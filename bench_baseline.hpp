@@ -0,0 +1,323 @@
+#ifndef SJTU_BENCH_BASELINE_HPP
+#define SJTU_BENCH_BASELINE_HPP
+
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench_phases.hpp"
+
+/**
+ * saving benchmark runs as a JSON baseline and comparing later runs against it.
+ *
+ * a baseline keeps the seconds of every trial of every phase, so a comparison can run
+ * Welch's t-test per phase instead of comparing two best-of numbers.
+ */
+namespace bench {
+    struct backend_trials {
+        long long checksum = 0;
+        // seconds of each trial, per phase
+        std::vector<double> seconds[PHASE_COUNT];
+    };
+
+    struct baseline {
+        config cfg;
+        std::map<std::string, backend_trials> backends;
+    };
+
+    // a minimal JSON value, enough to read back what save_baseline writes
+    struct json {
+        enum kind_t { NUL, BOOL, NUMBER, STRING, ARRAY, OBJECT } kind = NUL;
+        bool boolean = false;
+        double number = 0;
+        std::string string;
+        std::vector<json> array;
+        std::map<std::string, json> object;
+
+        const json *get(const std::string &key) const {
+            auto it = object.find(key);
+            return kind == OBJECT && it != object.end() ? &it->second : nullptr;
+        }
+    };
+
+    class json_parser {
+        const std::string &s;
+        size_t at;
+        std::string err;
+
+        void skip() { while (at < s.size() && isspace((unsigned char) s[at])) ++at; }
+
+        bool fail(const char *what) {
+            if (err.empty()) err = std::string(what) + " at offset " + std::to_string(at);
+            return false;
+        }
+
+        // consumes the closing bracket of an object or array
+        bool close() {
+            ++at;
+            return true;
+        }
+
+        bool literal(const char *word) {
+            size_t n = strlen(word);
+            if (s.compare(at, n, word) != 0) return fail("unexpected token");
+            at += n;
+            return true;
+        }
+
+        bool parse_string(std::string &out) {
+            if (s[at] != '"') return fail("expected a string");
+            for (++at; at < s.size() && s[at] != '"'; ++at) {
+                if (s[at] == '\\' && at + 1 < s.size()) ++at;
+                out += s[at];
+            }
+            if (at >= s.size()) return fail("unterminated string");
+            ++at;
+            return true;
+        }
+
+        bool parse(json &v) {
+            skip();
+            if (at >= s.size()) return fail("unexpected end");
+            char c = s[at];
+            if (c == '{') {
+                v.kind = json::OBJECT;
+                ++at;
+                skip();
+                if (at < s.size() && s[at] == '}') return close();
+                while (true) {
+                    skip();
+                    std::string key;
+                    if (!parse_string(key)) return false;
+                    skip();
+                    if (at >= s.size() || s[at] != ':') return fail("expected ':'");
+                    ++at;
+                    if (!parse(v.object[key])) return false;
+                    skip();
+                    if (at < s.size() && s[at] == ',') ++at;
+                    else if (at < s.size() && s[at] == '}') return close();
+                    else return fail("expected ',' or '}'");
+                }
+            }
+            if (c == '[') {
+                v.kind = json::ARRAY;
+                ++at;
+                skip();
+                if (at < s.size() && s[at] == ']') return close();
+                while (true) {
+                    v.array.emplace_back();
+                    if (!parse(v.array.back())) return false;
+                    skip();
+                    if (at < s.size() && s[at] == ',') ++at;
+                    else if (at < s.size() && s[at] == ']') return close();
+                    else return fail("expected ',' or ']'");
+                }
+            }
+            if (c == '"') {
+                v.kind = json::STRING;
+                return parse_string(v.string);
+            }
+            if (c == 't' || c == 'f') {
+                v.kind = json::BOOL;
+                v.boolean = c == 't';
+                return literal(v.boolean ? "true" : "false");
+            }
+            if (c == 'n') return literal("null");
+            char *end;
+            v.kind = json::NUMBER;
+            v.number = strtod(s.c_str() + at, &end);
+            if (end == s.c_str() + at) return fail("unexpected character");
+            at = end - s.c_str();
+            return true;
+        }
+
+    public:
+        explicit json_parser(const std::string &s) : s(s), at(0) {}
+
+        bool parse_document(json &v) {
+            if (!parse(v)) return false;
+            skip();
+            return at == s.size() || fail("trailing characters");
+        }
+
+        const std::string &error() const { return err; }
+    };
+
+    inline bool save_baseline(const char *path, const baseline &b) {
+        FILE *f = fopen(path, "w");
+        if (!f) return false;
+        const config &c = b.cfg;
+        fprintf(f, "{\n  \"format\": \"sjtu-deque-baseline-1\",\n");
+        fprintf(f, "  \"config\": {\"num\": %d, \"N\": %d, \"test_num\": %d, \"bulk\": %d, \"keep\": %d, "
+                   "\"static_num\": %d, \"good_complexity\": %s, \"seed\": %u, \"dist\": \"%s\"},\n",
+                c.num, c.N, c.test_num, c.bulk, c.keep, c.static_num, c.good_complexity ? "true" : "false",
+                c.seed, distribution_names[c.work.dist]);
+        fprintf(f, "  \"backends\": {");
+        bool first_backend = true;
+        for (auto &kv : b.backends) {
+            fprintf(f, "%s\n    \"%s\": {\n      \"checksum\": %lld,\n      \"phases\": {",
+                    first_backend ? "" : ",", kv.first.c_str(), kv.second.checksum);
+            first_backend = false;
+            bool first_phase = true;
+            for (int p = 0; p < PHASE_COUNT; p++) {
+                const std::vector<double> &t = kv.second.seconds[p];
+                if (t.empty()) continue;
+                fprintf(f, "%s\n        \"%s\": [", first_phase ? "" : ",", phase_names[p]);
+                first_phase = false;
+                for (size_t i = 0; i < t.size(); i++) fprintf(f, "%s%.9g", i ? ", " : "", t[i]);
+                fprintf(f, "]");
+            }
+            fprintf(f, "\n      }\n    }");
+        }
+        fprintf(f, "\n  }\n}\n");
+        return fclose(f) == 0;
+    }
+
+    inline bool load_baseline(const char *path, baseline &b, std::string &error) {
+        FILE *f = fopen(path, "r");
+        if (!f) {
+            error = std::string("cannot open ") + path;
+            return false;
+        }
+        std::string text;
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+        fclose(f);
+
+        json doc;
+        json_parser parser(text);
+        if (!parser.parse_document(doc)) {
+            error = std::string(path) + ": " + parser.error();
+            return false;
+        }
+        const json *format = doc.get("format");
+        if (!format || format->string != "sjtu-deque-baseline-1") {
+            error = std::string(path) + ": not a baseline file";
+            return false;
+        }
+        if (const json *c = doc.get("config")) {
+            auto number = [&](const char *key, double fallback) {
+                const json *v = c->get(key);
+                return v && v->kind == json::NUMBER ? v->number : fallback;
+            };
+            b.cfg.num = int(number("num", b.cfg.num));
+            b.cfg.N = int(number("N", b.cfg.N));
+            b.cfg.test_num = int(number("test_num", b.cfg.test_num));
+            b.cfg.bulk = int(number("bulk", b.cfg.bulk));
+            b.cfg.keep = int(number("keep", b.cfg.keep));
+            b.cfg.static_num = int(number("static_num", b.cfg.static_num));
+            b.cfg.seed = unsigned(number("seed", b.cfg.seed));
+            if (const json *v = c->get("good_complexity")) b.cfg.good_complexity = v->boolean;
+            if (const json *v = c->get("dist")) parse_distribution(v->string, b.cfg.work.dist);
+        }
+        const json *backends = doc.get("backends");
+        if (!backends) return true;
+        for (auto &kv : backends->object) {
+            backend_trials &t = b.backends[kv.first];
+            if (const json *v = kv.second.get("checksum")) t.checksum = (long long) v->number;
+            const json *phases = kv.second.get("phases");
+            if (!phases) continue;
+            for (int p = 0; p < PHASE_COUNT; p++) {
+                const json *v = phases->get(phase_names[p]);
+                if (!v) continue;
+                for (const json &x : v->array) t.seconds[p].push_back(x.number);
+            }
+        }
+        return true;
+    }
+
+    // the fields of two configs that make their timings incomparable, empty if none
+    inline std::string config_difference(const config &a, const config &b) {
+        std::string d;
+        auto check = [&](const char *name, bool same) {
+            if (!same) d += std::string(d.empty() ? "" : ", ") + name;
+        };
+        check("operation counts", a.num == b.num && a.N == b.N && a.test_num == b.test_num && a.bulk == b.bulk &&
+                                  a.keep == b.keep && a.static_num == b.static_num);
+        check("bulk phases", a.good_complexity == b.good_complexity);
+        check("seed", a.seed == b.seed);
+        check("distribution", a.work.dist == b.work.dist);
+        return d;
+    }
+
+    /**
+     * regularized incomplete beta function I_x(a, b), by the continued fraction of
+     * Numerical Recipes (betacf), used for the tail of Student's t distribution.
+     */
+    inline double incomplete_beta(double a, double b, double x) {
+        if (x <= 0) return 0;
+        if (x >= 1) return 1;
+        if (x > (a + 1) / (a + b + 2)) return 1 - incomplete_beta(b, a, 1 - x);
+        const double tiny = 1e-300;
+        double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) +
+                                a * std::log(x) + b * std::log(1 - x)) / a;
+        double c = 1, d = 1 - (a + b) * x / (a + 1);
+        if (std::fabs(d) < tiny) d = tiny;
+        d = 1 / d;
+        double h = d;
+        for (int m = 1; m <= 300; m++) {
+            double num = m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+            d = 1 + num * d;
+            if (std::fabs(d) < tiny) d = tiny;
+            c = 1 + num / c;
+            if (std::fabs(c) < tiny) c = tiny;
+            d = 1 / d;
+            h *= d * c;
+            num = -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+            d = 1 + num * d;
+            if (std::fabs(d) < tiny) d = tiny;
+            c = 1 + num / c;
+            if (std::fabs(c) < tiny) c = tiny;
+            d = 1 / d;
+            double delta = d * c;
+            h *= delta;
+            if (std::fabs(delta - 1) < 1e-12) break;
+        }
+        return front * h;
+    }
+
+    struct welch_result {
+        double mean_a, mean_b;
+        // relative change of the mean from a to b
+        double delta;
+        // two-sided p-value, 1 when there are too few trials to tell
+        double p;
+    };
+
+    inline welch_result welch_test(const std::vector<double> &a, const std::vector<double> &b) {
+        auto moments = [](const std::vector<double> &v, double &mean, double &var) {
+            mean = 0;
+            for (double x : v) mean += x;
+            mean /= v.size();
+            var = 0;
+            for (double x : v) var += (x - mean) * (x - mean);
+            var = v.size() > 1 ? var / (v.size() - 1) : 0;
+        };
+        welch_result r = {0, 0, 0, 1};
+        if (a.empty() || b.empty()) return r;
+        double va, vb;
+        moments(a, r.mean_a, va);
+        moments(b, r.mean_b, vb);
+        r.delta = r.mean_a > 0 ? (r.mean_b - r.mean_a) / r.mean_a : 0;
+        if (a.size() < 2 || b.size() < 2) return r;
+        double sa = va / a.size(), sb = vb / b.size();
+        double se = sa + sb;
+        if (se <= 0) {
+            r.p = r.mean_a == r.mean_b ? 1 : 0;
+            return r;
+        }
+        double t = (r.mean_b - r.mean_a) / std::sqrt(se);
+        double df = se * se / (sa * sa / (a.size() - 1) + sb * sb / (b.size() - 1));
+        r.p = incomplete_beta(df / 2, 0.5, df / (df + t * t));
+        return r;
+    }
+}
+
+#endif
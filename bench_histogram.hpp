@@ -0,0 +1,134 @@
+#ifndef SJTU_BENCH_HISTOGRAM_HPP
+#define SJTU_BENCH_HISTOGRAM_HPP
+
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+
+#if defined(BENCH_USE_RDTSC) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define BENCH_HAS_RDTSC 1
+#endif
+
+namespace bench {
+    /**
+     * log-linear latency histogram.
+     * values below 2^SUB_BITS get a bucket each, every power of two above that
+     * is cut into 2^SUB_BITS linear sub-buckets, so the relative error of a
+     * reported percentile is below 1 / 2^SUB_BITS (6.25%).
+     */
+    class histogram {
+        static const int SUB_BITS = 4;
+        static const int SUB_COUNT = 1 << SUB_BITS;
+        static const int BUCKETS = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+        uint64_t bucket[BUCKETS];
+        uint64_t _count, _max, _sum;
+
+        static int index_of(uint64_t v) {
+            if (v < SUB_COUNT) return int(v);
+            int e = 63 - __builtin_clzll(v);
+            return ((e - SUB_BITS + 1) << SUB_BITS) | int((v >> (e - SUB_BITS)) & (SUB_COUNT - 1));
+        }
+
+        // the largest value falling into bucket i
+        static uint64_t upper_of(int i) {
+            if (i < SUB_COUNT) return uint64_t(i);
+            int e = (i >> SUB_BITS) + SUB_BITS - 1;
+            uint64_t lower = (uint64_t(SUB_COUNT) | uint64_t(i & (SUB_COUNT - 1))) << (e - SUB_BITS);
+            return lower + (uint64_t(1) << (e - SUB_BITS)) - 1;
+        }
+
+    public:
+        histogram() { clear(); }
+
+        void clear() {
+            memset(bucket, 0, sizeof bucket);
+            _count = _max = _sum = 0;
+        }
+
+        void record(uint64_t v) {
+            ++bucket[index_of(v)];
+            ++_count;
+            _sum += v;
+            if (v > _max) _max = v;
+        }
+
+        void merge(const histogram &that) {
+            for (int i = 0; i < BUCKETS; i++) bucket[i] += that.bucket[i];
+            _count += that._count;
+            _sum += that._sum;
+            if (that._max > _max) _max = that._max;
+        }
+
+        uint64_t count() const { return _count; }
+
+        uint64_t max() const { return _max; }
+
+        double mean() const { return _count ? double(_sum) / _count : 0; }
+
+        /**
+         * the smallest bucket bound below which at least p (0 < p <= 1) of the samples fall,
+         * capped by the exact maximum.
+         */
+        uint64_t percentile(double p) const {
+            if (_count == 0) return 0;
+            uint64_t rank = uint64_t(p * _count + 0.5);
+            if (rank < 1) rank = 1;
+            uint64_t seen = 0;
+            for (int i = 0; i < BUCKETS; i++) {
+                seen += bucket[i];
+                if (seen >= rank) return upper_of(i) < _max ? upper_of(i) : _max;
+            }
+            return _max;
+        }
+    };
+
+    /**
+     * per-operation clock, steady_clock by default,
+     * rdtsc when built with -DBENCH_USE_RDTSC on x86 (calibrated against steady_clock).
+     */
+    class op_clock {
+#ifdef BENCH_HAS_RDTSC
+        double ns_per_tick;
+#endif
+    public:
+        op_clock() {
+#ifdef BENCH_HAS_RDTSC
+            auto start = std::chrono::steady_clock::now();
+            uint64_t t0 = __rdtsc();
+            while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(20));
+            uint64_t t1 = __rdtsc();
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            ns_per_tick = ns / double(t1 - t0);
+#endif
+        }
+
+        static const char *name() {
+#ifdef BENCH_HAS_RDTSC
+            return "rdtsc";
+#else
+            return "steady_clock";
+#endif
+        }
+
+        uint64_t now() const {
+#ifdef BENCH_HAS_RDTSC
+            return __rdtsc();
+#else
+            return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+        }
+
+        uint64_t to_ns(uint64_t ticks) const {
+#ifdef BENCH_HAS_RDTSC
+            return uint64_t(ticks * ns_per_tick);
+#else
+            return ticks;
+#endif
+        }
+    };
+}
+
+#endif
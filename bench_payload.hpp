@@ -0,0 +1,75 @@
+#ifndef SJTU_BENCH_PAYLOAD_HPP
+#define SJTU_BENCH_PAYLOAD_HPP
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "bench_phases.hpp"
+
+/**
+ * element types for the payload matrix, all built from an int and read back with num()
+ * like the T of test7.
+ */
+namespace bench {
+    template<int Size>
+    class record {
+    private:
+        int x;
+        char pad[Size - sizeof(int)];
+    public:
+        record(int x) : x(x) { pad[0] = char(x); }
+
+        int num() const { return x; }
+    };
+
+    // short decimal strings, so libstdc++ keeps them in the small-string buffer inside the object
+    class string_record {
+    private:
+        std::string s;
+    public:
+        string_record(int x) : s(std::to_string(x)) {}
+
+        int num() const { return atoi(s.c_str()); }
+    };
+
+    class shared_record {
+    private:
+        std::shared_ptr<const int> p;
+    public:
+        // opts in to bulk relocation in the chunked backends, see relocation.hpp
+        typedef std::true_type trivially_relocatable;
+
+        shared_record(int x) : p(std::make_shared<const int>(x)) {}
+
+        int num() const { return *p; }
+    };
+
+    /**
+     * a tag type carrying one payload.
+     * survives_memcpy is false for types that break when their bytes are moved,
+     * a small std::string points into itself.
+     */
+    template<class P>
+    struct payload {
+        typedef P type;
+        const char *name;
+        bool survives_memcpy;
+    };
+
+    const char *const payload_names[] = {"int4", "record64", "record256", "string", "shared_ptr"};
+
+    const int payload_count = sizeof(payload_names) / sizeof(payload_names[0]);
+
+    template<typename Fn>
+    void for_each_payload(Fn &&fn) {
+        fn(payload<T>{payload_names[0], true});
+        fn(payload<record<64> >{payload_names[1], true});
+        fn(payload<record<256> >{payload_names[2], true});
+        fn(payload<string_record>{payload_names[3], false});
+        fn(payload<shared_record>{payload_names[4], true});
+    }
+}
+
+#endif
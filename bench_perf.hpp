@@ -0,0 +1,156 @@
+#ifndef SJTU_BENCH_PERF_HPP
+#define SJTU_BENCH_PERF_HPP
+
+#include <cstring>
+#include <cstdint>
+#include <string>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+    enum counter_id {
+        CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, DTLB_MISSES, COUNTER_COUNT
+    };
+
+    const char *const counter_names[COUNTER_COUNT] = {
+            "cycles", "instructions", "l1d_miss", "llc_miss", "branch_miss", "dtlb_miss"
+    };
+
+    struct perf_sample {
+        double value[COUNTER_COUNT];
+        bool valid[COUNTER_COUNT];
+    };
+
+    /**
+     * one perf_event_open group (cycles as leader) counting user space of this process.
+     * any counter the kernel refuses is left out, if the leader itself cannot be opened
+     * (no permission, no PMU in a container, not linux) available() is false and every
+     * sample comes back invalid, so callers never need to special-case it.
+     */
+    class perf_counters {
+        int fd[COUNTER_COUNT];
+        int order[COUNTER_COUNT], opened;
+        std::string _error;
+
+#ifdef __linux__
+        static void describe(counter_id id, perf_event_attr &attr) {
+            static const uint64_t cache_read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            memset(&attr, 0, sizeof attr);
+            attr.size = sizeof attr;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            switch (id) {
+                case CYCLES:
+                    attr.type = PERF_TYPE_HARDWARE;
+                    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                    break;
+                case INSTRUCTIONS:
+                    attr.type = PERF_TYPE_HARDWARE;
+                    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                    break;
+                case L1D_MISSES:
+                    attr.type = PERF_TYPE_HW_CACHE;
+                    attr.config = PERF_COUNT_HW_CACHE_L1D | cache_read_miss;
+                    break;
+                case LLC_MISSES:
+                    attr.type = PERF_TYPE_HARDWARE;
+                    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+                    break;
+                case BRANCH_MISSES:
+                    attr.type = PERF_TYPE_HARDWARE;
+                    attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+                    break;
+                default:
+                    attr.type = PERF_TYPE_HW_CACHE;
+                    attr.config = PERF_COUNT_HW_CACHE_DTLB | cache_read_miss;
+                    break;
+            }
+        }
+
+        static int open_event(perf_event_attr &attr, int group) {
+            return int(syscall(__NR_perf_event_open, &attr, 0, -1, group, 0));
+        }
+#endif
+
+    public:
+        perf_counters() : opened(0) {
+            for (int i = 0; i < COUNTER_COUNT; i++) fd[i] = -1;
+#ifdef __linux__
+            for (int i = 0; i < COUNTER_COUNT; i++) {
+                perf_event_attr attr;
+                describe(counter_id(i), attr);
+                attr.disabled = i == CYCLES;
+                fd[i] = open_event(attr, i == CYCLES ? -1 : fd[CYCLES]);
+                if (fd[i] < 0) {
+                    if (i == CYCLES) {
+                        _error = std::string("perf_event_open: ") + strerror(errno);
+                        return;
+                    }
+                    continue;
+                }
+                order[opened++] = i;
+            }
+#else
+            _error = "perf_event_open is only available on linux";
+#endif
+        }
+
+        perf_counters(const perf_counters &) = delete;
+
+        perf_counters &operator=(const perf_counters &) = delete;
+
+        ~perf_counters() {
+#ifdef __linux__
+            for (int i = COUNTER_COUNT - 1; i >= 0; i--) if (fd[i] >= 0) close(fd[i]);
+#endif
+        }
+
+        bool available() const { return fd[CYCLES] >= 0; }
+
+        const std::string &error() const { return _error; }
+
+        // zero every counter of the group and start counting
+        void restart() {
+#ifdef __linux__
+            if (!available()) return;
+            ioctl(fd[CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(fd[CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+        }
+
+        /**
+         * counts since the last restart(), scaled up if the kernel had to multiplex the group.
+         * counting continues from zero afterwards.
+         */
+        perf_sample read_and_restart() {
+            perf_sample s;
+            for (int i = 0; i < COUNTER_COUNT; i++) s.value[i] = 0, s.valid[i] = false;
+#ifdef __linux__
+            if (!available()) return s;
+            ioctl(fd[CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+            uint64_t buf[3 + COUNTER_COUNT];
+            ssize_t got = read(fd[CYCLES], buf, sizeof buf);
+            if (got >= ssize_t(3 * sizeof(uint64_t)) && buf[2] > 0) {
+                int nr = int(buf[0]) < opened ? int(buf[0]) : opened;
+                double scale = double(buf[1]) / double(buf[2]);
+                for (int k = 0; k < nr; k++) {
+                    s.value[order[k]] = double(buf[3 + k]) * scale;
+                    s.valid[order[k]] = true;
+                }
+            }
+            restart();
+#endif
+            return s;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,277 @@
+#ifndef SJTU_BENCH_PHASES_HPP
+#define SJTU_BENCH_PHASES_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <type_traits>
+#include <utility>
+
+#include "bench_alloc.hpp"
+#include "chunk_pool.hpp"
+#include "bench_histogram.hpp"
+#include "bench_perf.hpp"
+#include "bench_workload.hpp"
+
+namespace bench {
+    /**
+     * the same 4-byte payload used by test7_with_clock.cpp
+     */
+    class T {
+    private:
+        int x;
+    public:
+        T(int x) : x(x) {}
+
+        int num() const { return x; }
+
+        void change(int y) { x = y; }
+    };
+
+    // the element type of a deque, taken from its iterator
+    template<class Q>
+    struct value_of {
+        typedef typename std::decay<decltype(*std::declval<typename Q::iterator>())>::type type;
+    };
+
+    /**
+     * operation counts of every phase, defaults are the ones of test7
+     */
+    struct config {
+        int num = 500000;
+        int N = 300000;
+        int test_num = 5000000;
+        int bulk = 4000000;
+        int keep = 2010;
+        int static_num = 2000000;
+        bool good_complexity = true;
+        unsigned seed = 19260817;
+        // distribution of the positions of the random_* phases
+        workload work;
+
+        void scale(double f) {
+            num = std::max(1, int(num * f));
+            N = std::max(1, int(N * f));
+            test_num = std::max(10, int(test_num * f));
+            bulk = std::max(keep, int(bulk * f));
+            static_num = std::max(1, int(static_num * f));
+        }
+    };
+
+    enum phase_id {
+        PUSH_FRONT, POP_FRONT, PUSH_BACK, POP_BACK, RANDOM_OPERATION, RANDOM_ACCESS,
+        RANDOM_INSERT, RANDOM_ERASE, RANDOM_CALL, BULK_PUSH_BACK, POP_BACK_FRONT, STATIC_ACCESS,
+        PHASE_COUNT
+    };
+
+    const char *const phase_names[PHASE_COUNT] = {
+            "push_front", "pop_front", "push_back", "pop_back", "random_operation", "random_access",
+            "random_insert", "random_erase", "random_call", "bulk_push_back", "pop_back_front", "static_access"
+    };
+
+    struct phase_result {
+        double seconds;
+        long long ops;
+        // hardware counters of the phase, all invalid unless counters were passed to run_test7
+        perf_sample perf;
+        // allocator activity of the phase, all zero unless the backends allocate through counting_allocator
+        alloc_sample alloc;
+    };
+
+    struct run_result {
+        phase_result phase[PHASE_COUNT];
+        // sum of every value read, identical across backends fed the same seed
+        long long checksum;
+    };
+
+    class stopwatch {
+        std::chrono::steady_clock::time_point start;
+    public:
+        stopwatch() : start(std::chrono::steady_clock::now()) {}
+
+        // seconds since the last lap (or construction)
+        double lap() {
+            auto now = std::chrono::steady_clock::now();
+            double duration = std::chrono::duration<double>(now - start).count();
+            start = now;
+            return duration;
+        }
+    };
+
+    /**
+     * probes bracket every single operation of a phase with start() / stop(phase).
+     * null_probe compiles away, latency_probe times one out of every `sample` operations.
+     */
+    struct null_probe {
+        void start() {}
+
+        void stop(phase_id) {}
+    };
+
+    class latency_probe {
+        op_clock clock;
+        uint64_t started;
+        unsigned sample, tick;
+        bool active;
+    public:
+        histogram phase[PHASE_COUNT];
+
+        explicit latency_probe(unsigned sample = 1) : started(0), sample(sample ? sample : 1), tick(0), active(false) {}
+
+        void start() {
+            active = ++tick == sample;
+            if (active) {
+                tick = 0;
+                started = clock.now();
+            }
+        }
+
+        void stop(phase_id id) {
+            if (active) phase[id].record(clock.to_ns(clock.now() - started));
+        }
+    };
+
+    /**
+     * runs the phases of test7 against a fresh Q, whose elements are built from an int.
+     * positions come from a private generator seeded with cfg.seed and drawn from cfg.work,
+     * so every backend sees exactly the same sequence of operations.
+     * when counters is given, its group is read out and restarted at every phase boundary.
+     * bench::allocations() is reset before q is built and sampled at every phase boundary;
+     * the chunk pools are emptied first, so no run starts with buffers left by another.
+     */
+    template<class Q, class Probe>
+    run_result run_test7(const config &cfg, Probe &probe, perf_counters *counters = nullptr) {
+        typedef typename value_of<Q>::type V;
+        run_result r = {};
+        position_gen positions(cfg.seed, cfg.work);
+        std::mt19937 &rng = positions.engine();
+        alloc_counters &heap = allocations();
+        sjtu::chunk_pool_trim();
+        heap.reset();
+        Q q;
+        long long sum = 0;
+        if (counters) counters->restart();
+        stopwatch clock;
+
+        auto finish = [&](phase_id id, long long ops) {
+            r.phase[id].seconds = clock.lap();
+            r.phase[id].ops = ops;
+            if (counters) r.phase[id].perf = counters->read_and_restart();
+            r.phase[id].alloc = {heap.allocs, heap.frees, heap.peak_bytes, heap.live_bytes, (long long) q.size()};
+            heap.restart_phase();
+            clock.lap();
+        };
+
+        for (int i = 0; i < cfg.num; i++) {
+            probe.start();
+            q.push_front(V(i));
+            probe.stop(PUSH_FRONT);
+        }
+        finish(PUSH_FRONT, cfg.num);
+
+        for (int i = 0; i < cfg.num; i++) {
+            probe.start();
+            q.pop_front();
+            probe.stop(POP_FRONT);
+        }
+        finish(POP_FRONT, cfg.num);
+
+        for (int i = 0; i < cfg.num; i++) {
+            probe.start();
+            q.push_back(V(i));
+            probe.stop(PUSH_BACK);
+        }
+        finish(PUSH_BACK, cfg.num);
+
+        for (int i = 0; i < cfg.num; i++) {
+            probe.start();
+            q.pop_back();
+            probe.stop(POP_BACK);
+        }
+        finish(POP_BACK, cfg.num);
+
+        for (int i = 0; i < cfg.num; i++) {
+            probe.start();
+            if (i % 10 <= 3) q.push_back(V(i));
+            else if (i % 10 <= 7) q.push_front(V(i));
+            else if (i % 10 <= 8) q.pop_back();
+            else q.pop_front();
+            probe.stop(RANDOM_OPERATION);
+        }
+        finish(RANDOM_OPERATION, cfg.num);
+
+        typename Q::iterator it = q.begin() + (int(q.size()) - 10);
+        for (int i = 0; i < cfg.test_num; i++) {
+            probe.start();
+            sum += (*it).num();
+            sum += it->num();
+            if (i % (cfg.test_num / 10) == 0) it = q.begin() + int(positions.next(q.size()));
+            probe.stop(RANDOM_ACCESS);
+        }
+        finish(RANDOM_ACCESS, cfg.test_num);
+
+        for (int i = 0; i < cfg.N; i++) {
+            probe.start();
+            it = q.begin() + int(positions.next(q.size()));
+            q.insert(it, V(int(rng() & 0x7fffffff)));
+            probe.stop(RANDOM_INSERT);
+        }
+        finish(RANDOM_INSERT, cfg.N);
+
+        for (int i = 0; i < cfg.N; i++) {
+            probe.start();
+            it = q.begin() + int(positions.next(q.size()));
+            q.erase(it);
+            probe.stop(RANDOM_ERASE);
+        }
+        finish(RANDOM_ERASE, cfg.N);
+
+        for (int i = 0; i < cfg.N; i++) {
+            probe.start();
+            sum += q[positions.next(q.size())].num();
+            sum += q.at(positions.next(q.size())).num();
+            probe.stop(RANDOM_CALL);
+        }
+        finish(RANDOM_CALL, cfg.N);
+
+        if (cfg.good_complexity) {
+            q.clear();
+            for (int i = 0; i < cfg.bulk; i++) {
+                probe.start();
+                q.push_back(V(i));
+                probe.stop(BULK_PUSH_BACK);
+            }
+            finish(BULK_PUSH_BACK, cfg.bulk);
+
+            long long popped = 0;
+            while (int(q.size()) > cfg.keep) {
+                probe.start();
+                if (rng() % 2) q.pop_front();
+                else q.pop_back();
+                probe.stop(POP_BACK_FRONT);
+                ++popped;
+            }
+            finish(POP_BACK_FRONT, popped);
+
+            int hi = std::min(2000, int(q.size()) - 1), lo = hi / 2;
+            for (int i = 0; i < cfg.static_num; i++) {
+                probe.start();
+                sum += q[hi].num();
+                sum += q[lo].num();
+                probe.stop(STATIC_ACCESS);
+            }
+            finish(STATIC_ACCESS, cfg.static_num);
+        }
+
+        r.checksum = sum;
+        return r;
+    }
+
+    template<class Q>
+    run_result run_test7(const config &cfg, perf_counters *counters = nullptr) {
+        null_probe probe;
+        return run_test7<Q>(cfg, probe, counters);
+    }
+}
+
+#endif
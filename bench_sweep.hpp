@@ -0,0 +1,201 @@
+#ifndef SJTU_BENCH_SWEEP_HPP
+#define SJTU_BENCH_SWEEP_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "bench_phases.hpp"
+
+namespace bench {
+    enum sweep_op {
+        SWEEP_PUSH_BACK, SWEEP_FRONT, SWEEP_RANDOM_ACCESS, SWEEP_ITERATE, SWEEP_RANDOM_INSERT, SWEEP_RANDOM_ERASE,
+        SWEEP_OP_COUNT
+    };
+
+    const char *const sweep_op_names[SWEEP_OP_COUNT] = {
+            "push_back", "push_pop_front", "random_access", "iterate", "random_insert", "random_erase"
+    };
+
+    struct sweep_config {
+        double min_n = 1e3;
+        double max_n = 1e8;
+        int steps_per_decade = 2;
+        // operations timed per class and size, before the budget cut
+        int ops = 20000;
+        // seconds one class may take at one size, predicted from the previous size assuming O(n)
+        double budget = 2;
+        unsigned seed = 19260817;
+
+        std::vector<long long> sizes() const {
+            std::vector<long long> s;
+            double step = std::pow(10.0, 1.0 / std::max(1, steps_per_decade));
+            for (double n = min_n; n <= max_n * 1.0001; n *= step) {
+                long long v = (long long) std::llround(n);
+                if (s.empty() || v != s.back()) s.push_back(v);
+            }
+            return s;
+        }
+    };
+
+    struct sweep_point {
+        const char *backend;
+        int op;
+        long long n, ops;
+        double ns_per_op;
+    };
+
+    /**
+     * measures every sweep_op at every size of cfg against Q and appends the points.
+     * a class is dropped for the remaining (larger) sizes once even a handful of its
+     * operations would exceed the budget.
+     * the deque is rebuilt with n push_back for every size, which is reported as push_back.
+     */
+    template<class Q>
+    void run_sweep(const char *name, const sweep_config &cfg, std::vector<sweep_point> &out) {
+        std::mt19937 rng(cfg.seed);
+        double last_cost[SWEEP_OP_COUNT] = {};
+        long long last_n[SWEEP_OP_COUNT] = {};
+        bool dropped[SWEEP_OP_COUNT] = {};
+        long long sink = 0;
+
+        auto plan = [&](int op, long long n) -> long long {
+            if (dropped[op]) return 0;
+            if (last_n[op] == 0) return cfg.ops;
+            double predicted = last_cost[op] * double(n) / double(last_n[op]);
+            long long k = std::min<long long>(cfg.ops, (long long) (cfg.budget * 1e9 / std::max(predicted, 1.0)));
+            if (k < 10) {
+                dropped[op] = true;
+                return 0;
+            }
+            return k;
+        };
+        auto report = [&](int op, long long n, long long ops, double seconds) {
+            last_cost[op] = seconds * 1e9 / double(ops);
+            last_n[op] = n;
+            out.push_back(sweep_point{name, op, n, ops, last_cost[op]});
+        };
+
+        for (long long n : cfg.sizes()) {
+            // building is needed by every class, it gets ten budgets before the sweep stops
+            if (last_n[SWEEP_PUSH_BACK] && last_cost[SWEEP_PUSH_BACK] * n > cfg.budget * 1e10) break;
+            Q q;
+            stopwatch clock;
+            for (long long i = 0; i < n; i++) q.push_back(T(int(i)));
+            report(SWEEP_PUSH_BACK, n, n, clock.lap());
+
+            long long k = plan(SWEEP_FRONT, n);
+            if (k) {
+                clock.lap();
+                for (long long i = 0; i < k; i++) {
+                    q.push_front(T(int(i)));
+                    q.pop_front();
+                }
+                report(SWEEP_FRONT, n, k, clock.lap());
+            }
+
+            k = plan(SWEEP_RANDOM_ACCESS, n);
+            if (k) {
+                clock.lap();
+                for (long long i = 0; i < k; i++) sink += q[rng() % n].num();
+                report(SWEEP_RANDOM_ACCESS, n, k, clock.lap());
+            }
+
+            k = plan(SWEEP_ITERATE, n);
+            if (k) {
+                typename Q::iterator it = q.begin() + int(rng() % n), end = q.end();
+                clock.lap();
+                for (long long i = 0; i < k; i++) {
+                    sink += it->num();
+                    if (++it == end) it = q.begin();
+                }
+                report(SWEEP_ITERATE, n, k, clock.lap());
+            }
+
+            // inserts and erases alternate in batches, so the size stays within 10% of n
+            long long k_insert = plan(SWEEP_RANDOM_INSERT, n), k_erase = plan(SWEEP_RANDOM_ERASE, n);
+            long long batch = std::max(1LL, n / 10);
+            double insert_seconds = 0, erase_seconds = 0;
+            long long inserted = 0, erased = 0;
+            while (inserted < k_insert || erased < k_erase) {
+                long long b = std::min(batch, std::max(k_insert - inserted, k_erase - erased));
+                clock.lap();
+                for (long long i = 0; i < b; i++) q.insert(q.begin() + int(rng() % (q.size() + 1)), T(int(i)));
+                double t = clock.lap();
+                if (inserted < k_insert) insert_seconds += t, inserted += b;
+                for (long long i = 0; i < b; i++) q.erase(q.begin() + int(rng() % q.size()));
+                t = clock.lap();
+                if (erased < k_erase) erase_seconds += t, erased += b;
+            }
+            if (inserted) report(SWEEP_RANDOM_INSERT, n, inserted, insert_seconds);
+            if (erased) report(SWEEP_RANDOM_ERASE, n, erased, erase_seconds);
+        }
+        volatile long long keep = sink;
+        (void) keep;
+    }
+
+    enum complexity_model {
+        MODEL_CONSTANT, MODEL_LOG, MODEL_SQRT, MODEL_LINEAR, MODEL_COUNT
+    };
+
+    const char *const model_names[MODEL_COUNT] = {"O(1)", "O(log n)", "O(sqrt n)", "O(n)"};
+
+    inline double model_value(int model, double n) {
+        switch (model) {
+            case MODEL_CONSTANT:
+                return 1;
+            case MODEL_LOG:
+                return std::log2(n);
+            case MODEL_SQRT:
+                return std::sqrt(n);
+            default:
+                return n;
+        }
+    }
+
+    struct complexity_fit {
+        int best;
+        // root mean square of the relative error of c * f(n) against the measurement, per model
+        double error[MODEL_COUNT];
+        double coefficient[MODEL_COUNT];
+        // slope of log(cost) over log(n)
+        double exponent;
+    };
+
+    /**
+     * fits cost = c * f(n) for every model, minimizing the relative error,
+     * so small and large sizes weigh the same.
+     */
+    inline complexity_fit fit_complexity(const std::vector<double> &n, const std::vector<double> &cost) {
+        complexity_fit fit = {};
+        size_t m = n.size();
+        for (int model = 0; model < MODEL_COUNT; model++) {
+            double a = 0, b = 0;
+            for (size_t i = 0; i < m; i++) {
+                double r = model_value(model, n[i]) / cost[i];
+                a += r;
+                b += r * r;
+            }
+            double c = b > 0 ? a / b : 0, err = 0;
+            for (size_t i = 0; i < m; i++) {
+                double e = (c * model_value(model, n[i]) - cost[i]) / cost[i];
+                err += e * e;
+            }
+            fit.coefficient[model] = c;
+            fit.error[model] = m ? std::sqrt(err / m) : 0;
+            if (fit.error[model] < fit.error[fit.best]) fit.best = model;
+        }
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (size_t i = 0; i < m; i++) {
+            double x = std::log(n[i]), y = std::log(cost[i]);
+            sx += x, sy += y, sxx += x * x, sxy += x * y;
+        }
+        double d = m * sxx - sx * sx;
+        fit.exponent = d > 0 ? (m * sxy - sx * sy) / d : 0;
+        return fit;
+    }
+}
+
+#endif
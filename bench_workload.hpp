@@ -0,0 +1,113 @@
+#ifndef SJTU_BENCH_WORKLOAD_HPP
+#define SJTU_BENCH_WORKLOAD_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+
+namespace bench {
+    /**
+     * how positions of random_access / random_insert / random_erase / random_call are drawn.
+     *   uniform     rng() % n, the distribution of test7
+     *   zipf        rank k (0 = front) with probability ~ 1 / (k + 1)^skew
+     *   hotspot     hot_share of the positions fall in a window of hot_width * n around hot_at * n
+     *   sequential  a cursor moving one step forward per draw, wrapping at n (a sliding window)
+     *   front/back  u^bias * n for uniform u, measured from the front / the back
+     */
+    enum distribution {
+        DIST_UNIFORM, DIST_ZIPF, DIST_HOTSPOT, DIST_SEQUENTIAL, DIST_FRONT, DIST_BACK,
+        DIST_COUNT
+    };
+
+    const char *const distribution_names[DIST_COUNT] = {
+            "uniform", "zipf", "hotspot", "sequential", "front", "back"
+    };
+
+    inline bool parse_distribution(const std::string &name, distribution &out) {
+        for (int i = 0; i < DIST_COUNT; i++) {
+            if (name == distribution_names[i]) {
+                out = distribution(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    struct workload {
+        distribution dist = DIST_UNIFORM;
+        double skew = 1.0;
+        double bias = 3.0;
+        double hot_at = 0.5;
+        double hot_width = 0.001;
+        double hot_share = 0.9;
+    };
+
+    /**
+     * draws positions in [0, n) for a deque whose size n changes between draws.
+     * every draw of the uniform distribution takes exactly one rng(), so a uniform
+     * position_gen replays the sequence of test7 for the same seed.
+     * engine() is shared with the caller for the non-positional coin flips and values.
+     */
+    class position_gen {
+        std::mt19937 rng;
+        workload w;
+        long long cursor;
+
+        double unit() { return std::generate_canonical<double, 32>(rng); }
+
+        // continuous approximation of the inverse cdf of a zipf law over n ranks
+        long long zipf(long long n) {
+            double u = unit();
+            double x;
+            if (std::fabs(w.skew - 1.0) < 1e-9) {
+                x = std::pow(double(n) + 1, u);
+            } else {
+                double e = 1.0 - w.skew;
+                x = std::pow((std::pow(double(n) + 1, e) - 1) * u + 1, 1.0 / e);
+            }
+            return (long long) x - 1;
+        }
+
+        long long hotspot(long long n) {
+            if (unit() >= w.hot_share) return (long long) (rng() % n);
+            long long width = std::max(1LL, (long long) (w.hot_width * n));
+            long long from = (long long) (w.hot_at * n) - width / 2;
+            return from + (long long) (rng() % width);
+        }
+
+    public:
+        position_gen(unsigned seed, const workload &w) : rng(seed), w(w), cursor(0) {}
+
+        std::mt19937 &engine() { return rng; }
+
+        // a position in [0, n), n must be positive
+        long long next(long long n) {
+            long long pos = 0;
+            switch (w.dist) {
+                case DIST_UNIFORM:
+                    return (long long) (rng() % n);
+                case DIST_ZIPF:
+                    pos = zipf(n);
+                    break;
+                case DIST_HOTSPOT:
+                    pos = hotspot(n);
+                    break;
+                case DIST_SEQUENTIAL:
+                    pos = cursor++ % n;
+                    break;
+                case DIST_FRONT:
+                    pos = (long long) (std::pow(unit(), w.bias) * n);
+                    break;
+                case DIST_BACK:
+                    pos = n - 1 - (long long) (std::pow(unit(), w.bias) * n);
+                    break;
+                default:
+                    break;
+            }
+            return std::min(n - 1, std::max(0LL, pos));
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,463 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <memory>
+
+#include "bench_backends.hpp"
+#include "bench_phases.hpp"
+#include "bench_sweep.hpp"
+#include "bench_payload.hpp"
+#include "bench_baseline.hpp"
+
+/**
+ * runs the phases of test7 against every deque implementation and prints a comparison table.
+ *
+ *   benchmark [--backend name[,name...]] [--repeat k] [--scale f] [--seed s] [--no-bulk]
+ *             [--latency] [--sample k] [--perf] [--alloc]
+ *             [--dist name[,name...]] [--zipf-s s] [--bias e] [--hot-at f] [--hot-width f] [--hot-share f]
+ *             [--save-baseline path] [--compare path] [--alpha a]
+ *   benchmark --sweep [--backend ...] [--sweep-min n] [--sweep-max n] [--sweep-steps k]
+ *             [--sweep-ops k] [--sweep-budget s] [--csv path]
+ *   benchmark --matrix [--backend ...] [--repeat k] [--scale f] [--no-bulk]
+ *
+ * every backend gets the same operation sequence, the best of k runs is reported.
+ * --latency additionally times single operations (one out of every --sample) and prints
+ * p50 / p99 / p99.9 / max per phase, merged over all runs. Timing single operations adds
+ * clock overhead to the phase totals, so compare totals of runs without --latency.
+ * --perf reads a perf_event_open counter group around every phase and prints the counts
+ * per operation, it is skipped with a note where counters are unavailable (e.g. containers).
+ * --alloc prints allocations, frees, peak and live heap bytes per phase and the live bytes
+ * per element at the end of it, counted by the allocator every backend is built with.
+ * --dist draws the positions of the random_* phases from uniform (default), zipf, hotspot,
+ * sequential, front or back (see bench_workload.hpp), and repeats the whole run for each
+ * distribution listed; "all" lists every one of them.
+ *
+ * --save-baseline writes the seconds of every run of every phase to a JSON file,
+ * --compare runs Welch's t-test of each phase against such a file and reports the change
+ * of the mean, flagging phases whose p-value is below --alpha (0.05) as faster or slower.
+ * Both take the --repeat runs as trials, so use at least 5 of them on both sides.
+ * The exit status is 1 when some phase got significantly slower.
+ *
+ * --sweep measures each operation class at sizes from --sweep-min to --sweep-max
+ * (--sweep-steps sizes per decade), writes ns per operation to --csv (sweep.csv)
+ * and fits the cost of every class to O(1), O(log n), O(sqrt n) and O(n).
+ *
+ * --matrix runs the test7 phases for every backend with 4-byte, 64-byte and 256-byte
+ * records, std::string and std::shared_ptr elements, and prints Mops/s per phase.
+ * std::string is skipped on backends that relocate elements with memcpy.
+ */
+
+struct options {
+    bench::config cfg;
+    int repeat = 5;
+    bool latency = false;
+    unsigned sample = 1;
+    bool perf = false;
+    bool alloc = false;
+    bool sweep = false;
+    bool matrix = false;
+    bench::sweep_config sweep_cfg;
+    std::string csv = "sweep.csv";
+    std::vector<std::string> backends;
+    std::vector<bench::distribution> dists;
+    std::string save_baseline, compare;
+    double alpha = 0.05;
+
+    bool selected(const char *name) const {
+        if (backends.empty()) return true;
+        return std::find(backends.begin(), backends.end(), name) != backends.end();
+    }
+};
+
+struct column {
+    std::string name;
+    bench::run_result best;
+    bench::backend_trials trials;
+    std::shared_ptr<bench::latency_probe> latency;
+};
+
+static void usage() {
+    fprintf(stderr, "usage: benchmark [--backend name[,name...]] [--repeat k] [--scale f] [--seed s] [--no-bulk]\n");
+    fprintf(stderr, "                 [--latency] [--sample k] [--perf] [--alloc]\n");
+    fprintf(stderr, "                 [--dist name[,name...]] [--zipf-s s] [--bias e] [--hot-at f] [--hot-width f] [--hot-share f]\n");
+    fprintf(stderr, "                 [--save-baseline path] [--compare path] [--alpha a]\n");
+    fprintf(stderr, "       benchmark --sweep [--backend ...] [--sweep-min n] [--sweep-max n] [--sweep-steps k]\n");
+    fprintf(stderr, "                 [--sweep-ops k] [--sweep-budget s] [--csv path]\n");
+    fprintf(stderr, "       benchmark --matrix [--backend ...] [--repeat k] [--scale f] [--no-bulk]\n");
+    fprintf(stderr, "backends:");
+    for (int i = 0; i < bench::backend_count; i++) fprintf(stderr, " %s", bench::backend_names[i]);
+    fprintf(stderr, "\ndistributions:");
+    for (int i = 0; i < bench::DIST_COUNT; i++) fprintf(stderr, " %s", bench::distribution_names[i]);
+    fprintf(stderr, " all\n");
+    exit(1);
+}
+
+static void split_names(const std::string &s, std::vector<std::string> &out) {
+    size_t from = 0;
+    while (from <= s.size()) {
+        size_t to = s.find(',', from);
+        if (to == std::string::npos) to = s.size();
+        if (to > from) out.push_back(s.substr(from, to - from));
+        from = to + 1;
+    }
+}
+
+static options parse(int argc, char **argv) {
+    options opt;
+    double scale = 1;
+    std::vector<std::string> dists;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--backend" && has_value) split_names(argv[++i], opt.backends);
+        else if (arg == "--repeat" && has_value) opt.repeat = std::max(1, atoi(argv[++i]));
+        else if (arg == "--scale" && has_value) scale = atof(argv[++i]);
+        else if (arg == "--seed" && has_value) opt.cfg.seed = strtoul(argv[++i], NULL, 10);
+        else if (arg == "--no-bulk") opt.cfg.good_complexity = false;
+        else if (arg == "--latency") opt.latency = true;
+        else if (arg == "--sample" && has_value) opt.sample = std::max(1, atoi(argv[++i]));
+        else if (arg == "--perf") opt.perf = true;
+        else if (arg == "--alloc") opt.alloc = true;
+        else if (arg == "--dist" && has_value) split_names(argv[++i], dists);
+        else if (arg == "--zipf-s" && has_value) opt.cfg.work.skew = atof(argv[++i]);
+        else if (arg == "--bias" && has_value) opt.cfg.work.bias = atof(argv[++i]);
+        else if (arg == "--hot-at" && has_value) opt.cfg.work.hot_at = atof(argv[++i]);
+        else if (arg == "--hot-width" && has_value) opt.cfg.work.hot_width = atof(argv[++i]);
+        else if (arg == "--hot-share" && has_value) opt.cfg.work.hot_share = atof(argv[++i]);
+        else if (arg == "--save-baseline" && has_value) opt.save_baseline = argv[++i];
+        else if (arg == "--compare" && has_value) opt.compare = argv[++i];
+        else if (arg == "--alpha" && has_value) opt.alpha = atof(argv[++i]);
+        else if (arg == "--sweep") opt.sweep = true;
+        else if (arg == "--matrix") opt.matrix = true;
+        else if (arg == "--sweep-min" && has_value) opt.sweep_cfg.min_n = std::max(1.0, atof(argv[++i]));
+        else if (arg == "--sweep-max" && has_value) opt.sweep_cfg.max_n = atof(argv[++i]);
+        else if (arg == "--sweep-steps" && has_value) opt.sweep_cfg.steps_per_decade = std::max(1, atoi(argv[++i]));
+        else if (arg == "--sweep-ops" && has_value) opt.sweep_cfg.ops = std::max(10, atoi(argv[++i]));
+        else if (arg == "--sweep-budget" && has_value) opt.sweep_cfg.budget = atof(argv[++i]);
+        else if (arg == "--csv" && has_value) opt.csv = argv[++i];
+        else usage();
+    }
+    for (auto &name : opt.backends) {
+        bool known = false;
+        for (int i = 0; i < bench::backend_count; i++) known |= name == bench::backend_names[i];
+        if (!known) {
+            fprintf(stderr, "unknown backend %s\n", name.c_str());
+            usage();
+        }
+    }
+    for (auto &name : dists) {
+        bench::distribution d;
+        if (name == "all") {
+            for (int k = 0; k < bench::DIST_COUNT; k++) opt.dists.push_back(bench::distribution(k));
+        } else if (bench::parse_distribution(name, d)) {
+            opt.dists.push_back(d);
+        } else {
+            fprintf(stderr, "unknown distribution %s\n", name.c_str());
+            usage();
+        }
+    }
+    if (opt.dists.empty()) opt.dists.push_back(bench::DIST_UNIFORM);
+    opt.cfg.work.dist = opt.dists[0];
+    if (opt.dists.size() > 1 && (!opt.save_baseline.empty() || !opt.compare.empty())) {
+        fprintf(stderr, "--save-baseline and --compare take a single distribution\n");
+        usage();
+    }
+    if (scale <= 0) usage();
+    if (scale != 1) opt.cfg.scale(scale);
+    opt.sweep_cfg.seed = opt.cfg.seed;
+    return opt;
+}
+
+static void print_table(const std::vector<column> &cols, const bench::config &cfg) {
+    printf("\n%-18s", "phase (s)");
+    for (auto &c : cols) printf(" %21s", c.name.c_str());
+    printf("\n");
+    std::vector<double> total(cols.size(), 0);
+    for (int p = 0; p < bench::PHASE_COUNT; p++) {
+        if (!cfg.good_complexity && p >= bench::BULK_PUSH_BACK) break;
+        printf("%-18s", bench::phase_names[p]);
+        for (size_t i = 0; i < cols.size(); i++) {
+            printf(" %21.6f", cols[i].best.phase[p].seconds);
+            total[i] += cols[i].best.phase[p].seconds;
+        }
+        printf("\n");
+    }
+    printf("%-18s", "total");
+    for (double t : total) printf(" %21.6f", t);
+    printf("\n");
+
+    for (size_t i = 1; i < cols.size(); i++) {
+        if (cols[i].best.checksum != cols[0].best.checksum) {
+            printf("warning: checksum of %s differs from %s\n", cols[i].name.c_str(), cols[0].name.c_str());
+        }
+    }
+}
+
+static void print_latency(const column &c, const options &opt) {
+    printf("\nlatency (ns) of %s, %s, 1/%u ops sampled\n", c.name.c_str(), bench::op_clock::name(), opt.sample);
+    printf("%-18s %12s %10s %10s %10s %10s %12s\n", "phase", "count", "mean", "p50", "p99", "p99.9", "max");
+    for (int p = 0; p < bench::PHASE_COUNT; p++) {
+        const bench::histogram &h = c.latency->phase[p];
+        if (h.count() == 0) continue;
+        printf("%-18s %12llu %10.1f %10llu %10llu %10llu %12llu\n", bench::phase_names[p],
+               (unsigned long long) h.count(), h.mean(),
+               (unsigned long long) h.percentile(0.5), (unsigned long long) h.percentile(0.99),
+               (unsigned long long) h.percentile(0.999), (unsigned long long) h.max());
+    }
+}
+
+static void print_perf(const column &c, const bench::config &cfg) {
+    printf("\nhardware counters per op of %s\n", c.name.c_str());
+    printf("%-18s", "phase");
+    for (int k = 0; k < bench::COUNTER_COUNT; k++) printf(" %12s", bench::counter_names[k]);
+    printf(" %8s\n", "ipc");
+    for (int p = 0; p < bench::PHASE_COUNT; p++) {
+        if (!cfg.good_complexity && p >= bench::BULK_PUSH_BACK) break;
+        const bench::phase_result &r = c.best.phase[p];
+        printf("%-18s", bench::phase_names[p]);
+        for (int k = 0; k < bench::COUNTER_COUNT; k++) {
+            if (r.perf.valid[k] && r.ops > 0) printf(" %12.2f", r.perf.value[k] / r.ops);
+            else printf(" %12s", "n/a");
+        }
+        if (r.perf.valid[bench::CYCLES] && r.perf.valid[bench::INSTRUCTIONS] && r.perf.value[bench::CYCLES] > 0) {
+            printf(" %8.2f\n", r.perf.value[bench::INSTRUCTIONS] / r.perf.value[bench::CYCLES]);
+        } else {
+            printf(" %8s\n", "n/a");
+        }
+    }
+}
+
+static void print_alloc(const column &c, const bench::config &cfg) {
+    printf("\nheap of %s\n", c.name.c_str());
+    printf("%-18s %12s %12s %14s %14s %12s %10s\n", "phase", "allocs", "frees", "peak bytes", "live bytes",
+           "elements", "bytes/elem");
+    for (int p = 0; p < bench::PHASE_COUNT; p++) {
+        if (!cfg.good_complexity && p >= bench::BULK_PUSH_BACK) break;
+        const bench::alloc_sample &a = c.best.phase[p].alloc;
+        printf("%-18s %12lld %12lld %14lld %14lld %12lld", bench::phase_names[p],
+               a.allocs, a.frees, a.peak_bytes, a.live_bytes, a.elements);
+        if (a.elements > 0) printf(" %10.2f\n", double(a.live_bytes) / a.elements);
+        else printf(" %10s\n", "n/a");
+    }
+}
+
+static int sweep(const options &opt) {
+    std::vector<bench::sweep_point> points;
+    bench::for_each_backend([&](auto b) {
+        using Q = typename decltype(b)::template deque<bench::T>;
+        if (!opt.selected(b.name)) return;
+        std::cerr << b.name << " sweep" << std::endl;
+        bench::run_sweep<Q>(b.name, opt.sweep_cfg, points);
+    });
+
+    FILE *csv = fopen(opt.csv.c_str(), "w");
+    if (!csv) {
+        fprintf(stderr, "cannot open %s\n", opt.csv.c_str());
+        return 1;
+    }
+    fprintf(csv, "backend,op,n,ops,ns_per_op\n");
+    for (auto &p : points) {
+        fprintf(csv, "%s,%s,%lld,%lld,%.3f\n", p.backend, bench::sweep_op_names[p.op], p.n, p.ops, p.ns_per_op);
+    }
+    fclose(csv);
+    printf("wrote %zu points to %s\n", points.size(), opt.csv.c_str());
+
+    printf("\n%-21s %-15s %8s %8s %8s %-10s", "backend", "op", "sizes", "max n", "n^k", "best fit");
+    for (int m = 0; m < bench::MODEL_COUNT; m++) printf(" %10s", bench::model_names[m]);
+    printf("\n");
+    for (int i = 0; i < bench::backend_count; i++) {
+        for (int op = 0; op < bench::SWEEP_OP_COUNT; op++) {
+            std::vector<double> n, cost;
+            for (auto &p : points) {
+                if (p.op != op || strcmp(p.backend, bench::backend_names[i]) != 0) continue;
+                n.push_back(double(p.n));
+                cost.push_back(std::max(p.ns_per_op, 1e-3));
+            }
+            if (n.size() < 2) continue;
+            bench::complexity_fit fit = bench::fit_complexity(n, cost);
+            printf("%-21s %-15s %8zu %8.0e %8.2f %-10s", bench::backend_names[i], bench::sweep_op_names[op],
+                   n.size(), n.back(), fit.exponent, bench::model_names[fit.best]);
+            for (int m = 0; m < bench::MODEL_COUNT; m++) printf(" %9.1f%%", fit.error[m] * 100);
+            printf("\n");
+        }
+    }
+    printf("(model columns: rms relative error of the best c * f(n))\n");
+    return 0;
+}
+
+static int matrix(const options &opt) {
+    // best[phase][backend][payload], negative when skipped
+    std::vector<double> best(bench::PHASE_COUNT * bench::backend_count * bench::payload_count, -1);
+    std::vector<double> total(bench::backend_count * bench::payload_count, -1);
+    int bi = 0;
+    bench::for_each_backend([&](auto b) {
+        int pi = 0;
+        bench::for_each_payload([&](auto p) {
+            using Q = typename decltype(b)::template deque<typename decltype(p)::type>;
+            int cell = bi * bench::payload_count + pi++;
+            if (!opt.selected(b.name) || (b.memcpy_relocation && !p.survives_memcpy)) return;
+            long long ops = 0;
+            double seconds = 0;
+            for (int k = 0; k < opt.repeat; k++) {
+                std::cerr << b.name << " " << p.name << " run " << k + 1 << "/" << opt.repeat << std::endl;
+                bench::run_result r = bench::run_test7<Q>(opt.cfg);
+                for (int ph = 0; ph < bench::PHASE_COUNT; ph++) {
+                    if (r.phase[ph].seconds <= 0) continue;
+                    double mops = r.phase[ph].ops / r.phase[ph].seconds / 1e6;
+                    double &slot = best[ph * bench::backend_count * bench::payload_count + cell];
+                    slot = std::max(slot, mops);
+                    if (k == 0) ops += r.phase[ph].ops, seconds += r.phase[ph].seconds;
+                }
+            }
+            total[cell] = seconds > 0 ? ops / seconds / 1e6 : -1;
+        });
+        ++bi;
+    });
+
+    auto print = [&](const char *title, const double *cells) {
+        printf("\n%-21s", title);
+        for (int p = 0; p < bench::payload_count; p++) printf(" %12s", bench::payload_names[p]);
+        printf("\n");
+        for (int b = 0; b < bench::backend_count; b++) {
+            if (!opt.selected(bench::backend_names[b])) continue;
+            printf("%-21s", bench::backend_names[b]);
+            for (int p = 0; p < bench::payload_count; p++) {
+                double v = cells[b * bench::payload_count + p];
+                if (v < 0) printf(" %12s", "n/a");
+                else printf(" %12.3f", v);
+            }
+            printf("\n");
+        }
+    };
+    printf("throughput in Mops/s, best of %d runs per phase (n/a: skipped)\n", opt.repeat);
+    print("all phases (1st run)", total.data());
+    for (int ph = 0; ph < bench::PHASE_COUNT; ph++) {
+        if (!opt.cfg.good_complexity && ph >= bench::BULK_PUSH_BACK) break;
+        print(bench::phase_names[ph], best.data() + ph * bench::backend_count * bench::payload_count);
+    }
+    return 0;
+}
+
+static bench::baseline make_baseline(const std::vector<column> &cols, const bench::config &cfg) {
+    bench::baseline b;
+    b.cfg = cfg;
+    for (auto &c : cols) b.backends[c.name] = c.trials;
+    return b;
+}
+
+// returns the number of phases that got significantly slower
+static int print_regression(const std::vector<column> &cols, const bench::baseline &base, const options &opt) {
+    std::string diff = bench::config_difference(base.cfg, opt.cfg);
+    if (!diff.empty()) printf("\nwarning: the baseline was run with a different %s\n", diff.c_str());
+    int slower = 0;
+    for (auto &c : cols) {
+        auto found = base.backends.find(c.name);
+        if (found == base.backends.end()) {
+            printf("\n%s: not in the baseline\n", c.name.c_str());
+            continue;
+        }
+        const bench::backend_trials &old = found->second;
+        printf("\n%s against %s, Welch's t-test, alpha %.3g\n", c.name.c_str(), opt.compare.c_str(), opt.alpha);
+        printf("%-18s %12s %12s %9s %9s  %s\n", "phase", "base (s)", "new (s)", "delta", "p", "verdict");
+        for (int p = 0; p < bench::PHASE_COUNT; p++) {
+            if (old.seconds[p].empty() || c.trials.seconds[p].empty()) continue;
+            bench::welch_result w = bench::welch_test(old.seconds[p], c.trials.seconds[p]);
+            const char *verdict = "~";
+            if (w.p < opt.alpha) verdict = w.delta < 0 ? "faster" : "slower";
+            if (w.p < opt.alpha && w.delta > 0) ++slower;
+            printf("%-18s %12.6f %12.6f %+8.1f%% %9.4f  %s\n", bench::phase_names[p], w.mean_a, w.mean_b,
+                   w.delta * 100, w.p, verdict);
+        }
+        if (old.checksum != c.trials.checksum && diff.empty()) {
+            printf("warning: checksum differs from the baseline\n");
+        }
+    }
+    return slower;
+}
+
+static int run_comparison(const options &opt, bench::perf_counters *counters) {
+    std::vector<column> cols;
+    bench::for_each_backend([&](auto b) {
+        using Q = typename decltype(b)::template deque<bench::T>;
+        if (!opt.selected(b.name)) return;
+        column c;
+        c.name = b.name;
+        if (opt.latency) c.latency = std::make_shared<bench::latency_probe>(opt.sample);
+        for (int k = 0; k < opt.repeat; k++) {
+            std::cerr << b.name << " run " << k + 1 << "/" << opt.repeat << std::endl;
+            bench::run_result r = opt.latency ? bench::run_test7<Q>(opt.cfg, *c.latency, counters)
+                                              : bench::run_test7<Q>(opt.cfg, counters);
+            for (int p = 0; p < bench::PHASE_COUNT; p++) {
+                if (r.phase[p].ops > 0) c.trials.seconds[p].push_back(r.phase[p].seconds);
+            }
+            c.trials.checksum = r.checksum;
+            if (k == 0) {
+                c.best = r;
+                continue;
+            }
+            for (int p = 0; p < bench::PHASE_COUNT; p++) {
+                if (r.phase[p].seconds < c.best.phase[p].seconds) c.best.phase[p] = r.phase[p];
+            }
+        }
+        cols.push_back(c);
+    });
+
+    print_table(cols, opt.cfg);
+    if (opt.latency) {
+        for (auto &c : cols) print_latency(c, opt);
+    }
+    if (opt.perf) {
+        for (auto &c : cols) print_perf(c, opt.cfg);
+    }
+    if (opt.alloc) {
+        for (auto &c : cols) print_alloc(c, opt.cfg);
+    }
+
+    int slower = 0;
+    if (!opt.compare.empty()) {
+        bench::baseline base;
+        std::string error;
+        if (!bench::load_baseline(opt.compare.c_str(), base, error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 2;
+        }
+        slower = print_regression(cols, base, opt);
+    }
+    if (!opt.save_baseline.empty()) {
+        if (!bench::save_baseline(opt.save_baseline.c_str(), make_baseline(cols, opt.cfg))) {
+            fprintf(stderr, "cannot write %s\n", opt.save_baseline.c_str());
+            return 2;
+        }
+        fprintf(stderr, "baseline saved to %s\n", opt.save_baseline.c_str());
+    }
+    return slower ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    options opt = parse(argc, argv);
+    if (opt.sweep) return sweep(opt);
+    if (opt.matrix) return matrix(opt);
+    std::unique_ptr<bench::perf_counters> counters;
+    if (opt.perf) {
+        counters.reset(new bench::perf_counters);
+        if (!counters->available()) {
+            fprintf(stderr, "hardware counters unavailable (%s), continuing without them\n", counters->error().c_str());
+            counters.reset();
+            opt.perf = false;
+        }
+    }
+
+    int status = 0;
+    for (bench::distribution d : opt.dists) {
+        opt.cfg.work.dist = d;
+        if (opt.dists.size() > 1 || d != bench::DIST_UNIFORM) {
+            printf("\n== positions: %s\n", bench::distribution_names[d]);
+        }
+        status = std::max(status, run_comparison(opt, counters.get()));
+    }
+    return status;
+}
@@ -0,0 +1,193 @@
+#ifndef SJTU_CHUNK_POOL_HPP
+#define SJTU_CHUNK_POOL_HPP
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// every buffer and node is allocated through this, define it before including to hook allocations
+#ifndef SJTU_DEQUE_ALLOCATOR
+#define SJTU_DEQUE_ALLOCATOR std::allocator
+#endif
+
+/**
+ * free lists for the chunk buffers of the sqrt and fenwick deques.
+ *
+ * chunk capacities are powers of two, so a buffer dropped by merge_chunk or shrink_if_small
+ * fits the next split_chunk or expand_to of the same class. buffers of each element type are
+ * kept in one list per capacity, shared by every deque of the process, up to the limits
+ * set with set_chunk_pool_limits; whatever exceeds them goes straight back to the allocator.
+ */
+namespace sjtu {
+    struct chunk_pool_limits {
+        // free buffers kept per element type and capacity, 0 turns pooling off
+        size_t buffers_per_class = 8;
+        // bytes kept in free buffers over all pools
+        size_t retained_bytes = size_t(32) << 20;
+    };
+
+    struct chunk_pool_stats {
+        // allocations served from a free list / by the allocator
+        unsigned long long hits = 0, misses = 0;
+        // deallocations kept in a free list / handed back to the allocator, trims included
+        unsigned long long kept = 0, released = 0;
+        // what the free lists hold right now
+        size_t retained_buffers = 0, retained_bytes = 0;
+    };
+
+    class chunk_pool_base {
+    public:
+        // hands every free buffer back to the allocator, called with the registry locked
+        virtual void release_all() = 0;
+    };
+
+    /**
+     * limits, stats and the pools of all element types, behind one mutex.
+     * it is never destroyed, so deques with static storage can still return buffers at exit.
+     */
+    struct chunk_pool_registry {
+        std::mutex mutex;
+        chunk_pool_limits limits;
+        chunk_pool_stats stats;
+        std::vector<chunk_pool_base *> pools;
+
+        static chunk_pool_registry &get() {
+            static chunk_pool_registry *registry = new chunk_pool_registry;
+            return *registry;
+        }
+
+        void release_all() {
+            for (chunk_pool_base *pool : pools) pool->release_all();
+        }
+    };
+
+    template<class U>
+    class chunk_pool : public chunk_pool_base {
+        static const int classes = 8 * sizeof(size_t);
+
+        // a free buffer stores the next one of its list in its first bytes
+        struct free_buffer {
+            free_buffer *next;
+        };
+
+        free_buffer *head[classes];
+        size_t count[classes];
+        SJTU_DEQUE_ALLOCATOR<U> alloc;
+
+        chunk_pool() {
+            for (int i = 0; i < classes; i++) {
+                head[i] = nullptr;
+                count[i] = 0;
+            }
+        }
+
+        // the list of a capacity, -1 for one that is not a power of two or too small to hold the link
+        static int size_class(size_t n) {
+            if (n == 0 || (n & (n - 1)) || n * sizeof(U) < sizeof(free_buffer)) return -1;
+            int c = 0;
+            while ((size_t(1) << c) < n) ++c;
+            return c;
+        }
+
+    public:
+        static chunk_pool &get() {
+            static chunk_pool *pool = [] {
+                chunk_pool *p = new chunk_pool;
+                chunk_pool_registry &r = chunk_pool_registry::get();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                r.pools.push_back(p);
+                return p;
+            }();
+            return *pool;
+        }
+
+        U *allocate(size_t n) {
+            int c = size_class(n);
+            if (c >= 0) {
+                chunk_pool_registry &r = chunk_pool_registry::get();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                if (free_buffer *b = head[c]) {
+                    head[c] = b->next;
+                    --count[c];
+                    ++r.stats.hits;
+                    --r.stats.retained_buffers;
+                    r.stats.retained_bytes -= n * sizeof(U);
+                    return reinterpret_cast<U *>(b);
+                }
+                ++r.stats.misses;
+            }
+            return alloc.allocate(n);
+        }
+
+        void deallocate(U *p, size_t n) {
+            int c = size_class(n);
+            if (c >= 0) {
+                chunk_pool_registry &r = chunk_pool_registry::get();
+                std::lock_guard<std::mutex> lock(r.mutex);
+                if (count[c] < r.limits.buffers_per_class &&
+                    r.stats.retained_bytes + n * sizeof(U) <= r.limits.retained_bytes) {
+                    free_buffer *b = ::new((void *) p) free_buffer;
+                    b->next = head[c];
+                    head[c] = b;
+                    ++count[c];
+                    ++r.stats.kept;
+                    ++r.stats.retained_buffers;
+                    r.stats.retained_bytes += n * sizeof(U);
+                    return;
+                }
+                ++r.stats.released;
+            }
+            alloc.deallocate(p, n);
+        }
+
+        void release_all() override {
+            chunk_pool_registry &r = chunk_pool_registry::get();
+            for (int c = 0; c < classes; c++) {
+                size_t n = size_t(1) << c;
+                while (free_buffer *b = head[c]) {
+                    head[c] = b->next;
+                    alloc.deallocate(reinterpret_cast<U *>(b), n);
+                    ++r.stats.released;
+                    --r.stats.retained_buffers;
+                    r.stats.retained_bytes -= n * sizeof(U);
+                }
+                count[c] = 0;
+            }
+        }
+    };
+
+    /**
+     * SJTU_DEQUE_ALLOCATOR with allocate / deallocate served by chunk_pool<U>,
+     * for the buffers of the chunk Vector
+     */
+    template<class U>
+    struct pooled_allocator : SJTU_DEQUE_ALLOCATOR<U> {
+        U *allocate(size_t n) { return chunk_pool<U>::get().allocate(n); }
+
+        void deallocate(U *p, size_t n) { chunk_pool<U>::get().deallocate(p, n); }
+    };
+
+    inline chunk_pool_stats chunk_pool_statistics() {
+        chunk_pool_registry &r = chunk_pool_registry::get();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        return r.stats;
+    }
+
+    // sets new retention limits and empties the free lists, which refill under the new ones
+    inline void set_chunk_pool_limits(const chunk_pool_limits &limits) {
+        chunk_pool_registry &r = chunk_pool_registry::get();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.limits = limits;
+        r.release_all();
+    }
+
+    // hands every free buffer back to the allocator
+    inline void chunk_pool_trim() {
+        chunk_pool_registry &r = chunk_pool_registry::get();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.release_all();
+    }
+}
+
+#endif
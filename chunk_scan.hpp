@@ -0,0 +1,61 @@
+#ifndef SJTU_CHUNK_SCAN_HPP
+#define SJTU_CHUNK_SCAN_HPP
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * the walk of find_at over the chunk sizes of the sqrt deques, on a dense int array.
+ *
+ * the sizes are not negative, so the walk passes a block of them exactly when it passes their sum:
+ * blocks of 8 are summed with AVX2 (-mavx2) or SSE2 and skipped whole, and only the block the walk
+ * stops in is stepped through one size at a time. without SIMD the block sum is scalar.
+ */
+namespace sjtu {
+    // a[0] + ... + a[7]
+    inline int sum_of_8(const int *a) {
+#if defined(__AVX2__)
+        __m256i v = _mm256_loadu_si256((const __m256i *) a);
+        __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+#elif defined(__SSE2__)
+        __m128i s = _mm_add_epi32(_mm_loadu_si128((const __m128i *) a), _mm_loadu_si128((const __m128i *) (a + 4)));
+#endif
+#if defined(__AVX2__) || defined(__SSE2__)
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+        s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+        return _mm_cvtsi128_si32(s);
+#else
+        return a[0] + a[1] + a[2] + a[3] + a[4] + a[5] + a[6] + a[7];
+#endif
+    }
+
+    /**
+     * walks the n sizes a from the front, taking a[i] off left while a[i] < left
+     * (a[i] <= left with or_equal), and returns the index it stops at, n if it never does.
+     */
+    inline int scan_forward(const int *a, int n, int &left, bool or_equal) {
+        int i = 0;
+        for (; i + 8 <= n; i += 8) {
+            int s = sum_of_8(a + i);
+            if (or_equal ? s > left : s >= left) break;
+            left -= s;
+        }
+        for (; i < n && (or_equal ? a[i] <= left : a[i] < left); i++) left -= a[i];
+        return i;
+    }
+
+    // the same walk from the back, it stops at index 0 at the latest
+    inline int scan_backward(const int *a, int n, int &left, bool or_equal) {
+        int i = n;
+        for (; i - 8 >= 1; i -= 8) {
+            int s = sum_of_8(a + i - 8);
+            if (or_equal ? s > left : s >= left) break;
+            left -= s;
+        }
+        for (--i; i > 0 && (or_equal ? a[i] <= left : a[i] < left); i--) left -= a[i];
+        return i;
+    }
+}
+
+#endif
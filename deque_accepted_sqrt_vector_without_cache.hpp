@@ -3,26 +3,42 @@
 
 #include "exceptions.hpp"
 #include "utility.hpp"
+#include "relocation.hpp"
+#include "chunk_scan.hpp"
 
 #include <cstddef>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <type_traits>
 #include <memory>
+#include <utility>
 #include <vector>
 #include <iostream>
 
+// every buffer and node is allocated through this, define it before including to hook allocations
+#ifndef SJTU_DEQUE_ALLOCATOR
+#define SJTU_DEQUE_ALLOCATOR std::allocator
+#endif
+
 namespace sjtu {
     template<class T>
     class deque {
     private:
-        static const int INSERT_GC_THRESHOLD = 10000;
-        static const int REMOVE_GC_THRESHOLD = 10000;
+        // chunks gc_step() examines per insert / remove
+        static const int GC_STEP = 2;
 
         template<class U>
         class Vector {
+        public:
+            // a Vector only owns its buffer through a pointer, moving its bytes is enough
+            typedef std::true_type trivially_relocatable;
+        private:
             static const int min_chunk_size = 512;
             friend deque;
             U *buffer;
             int _size, _cap;
-            std::allocator<U> alloc;
+            SJTU_DEQUE_ALLOCATOR<U> alloc;
 
             bool full() { return _size == _cap; }
 
@@ -34,7 +50,7 @@ namespace sjtu {
 
             void expand_to(int new_cap) {
                 U *new_buffer = alloc.allocate(new_cap);
-                memcpy(new_buffer, buffer, sizeof(U) * _size);
+                relocate(new_buffer, buffer, _size);
                 alloc.deallocate(buffer, _cap);
                 _cap = new_cap;
                 buffer = new_buffer;
@@ -46,7 +62,7 @@ namespace sjtu {
 
             void expand_if_full() {
                 if (!full()) return;
-                expand_to(_cap << 1);
+                expand_to(fit(_cap + 1));
             }
 
             U *get_buffer() {
@@ -76,20 +92,48 @@ namespace sjtu {
 
             int size() const { return _size; }
 
-            void insert(int pos, const U &x) {
+            // constructs an element from args right in the gap opened at pos
+            template<class... Args>
+            void emplace(int pos, Args &&... args) {
                 expand_if_full();
-                if (pos != _size) memmove(buffer + pos + 1, buffer + pos, (_size - pos) * sizeof(U));
-                alloc.construct(buffer + pos, x);
+                if (pos != _size) relocate(buffer + pos + 1, buffer + pos, _size - pos);
+                alloc.construct(buffer + pos, std::forward<Args>(args)...);
                 ++_size;
             }
 
+            /**
+             * opens a gap of n at pos and lets fill(slot) construct the new elements in order.
+             * if fill throws, the gap closes over the slots not yet filled.
+             */
+            template<class Fill>
+            void fill_n(int pos, int n, Fill &fill) {
+                if (_size + n > _cap) expand_to(fit(_size + n));
+                relocate(buffer + pos + n, buffer + pos, _size - pos);
+                int done = 0;
+                try {
+                    for (; done < n; done++) fill(buffer + pos + done);
+                } catch (...) {
+                    relocate(buffer + pos + done, buffer + pos + n, _size - pos);
+                    _size += done;
+                    throw;
+                }
+                _size += n;
+            }
+
             void erase(int pos) {
                 alloc.destroy(buffer + pos);
-                if (pos != _size - 1) memmove(buffer + pos, buffer + pos + 1, (_size - pos - 1) * sizeof(U));
+                if (pos != _size - 1) relocate(buffer + pos, buffer + pos + 1, _size - pos - 1);
                 --_size;
                 shrink_if_small();
             }
 
+            void erase(int from, int to) {
+                for (int i = from; i < to; i++) alloc.destroy(buffer + i);
+                relocate(buffer + from, buffer + to, _size - to);
+                _size -= to - from;
+                shrink_if_small();
+            }
+
             void clear() {
                 for (int i = 0; i < _size; i++) alloc.destroy(buffer + i);
                 _size = 0;
@@ -105,8 +149,59 @@ namespace sjtu {
             const U &operator[](int pos) const { return buffer[pos]; }
         };
 
+        /**
+         * the chunk sizes again, packed into one array for scan_forward / scan_backward.
+         * single chunk changes are mirrored right away, shifting a few ints where x shifts whole
+         * Vectors; bulk changes call invalidate() with the first chunk they touch instead, and the
+         * entries from stale on are copied from x by the next sync().
+         */
+        class ChunkSizes {
+            std::vector<int, SJTU_DEQUE_ALLOCATOR<int> > sizes;
+            int stale = 0;
+        public:
+            void resized(int chunk, int size) { if (chunk < stale) sizes[chunk] = size; }
+
+            // chunk was cut into chunk and chunk + 1
+            void split(int chunk, int size_a, int size_b) {
+                if (chunk >= stale) return;
+                sizes[chunk] = size_a;
+                sizes.insert(sizes.begin() + chunk + 1, size_b);
+                ++stale;
+            }
+
+            // chunk + 1 was moved into chunk
+            void merged(int chunk, int size) {
+                if (chunk + 1 >= stale) return invalidate(chunk);
+                sizes[chunk] = size;
+                sizes.erase(sizes.begin() + chunk + 1);
+                --stale;
+            }
+
+            void erased(int chunk) {
+                if (chunk >= stale) return;
+                sizes.erase(sizes.begin() + chunk);
+                --stale;
+            }
+
+            void invalidate(int chunk) { stale = std::min(stale, chunk); }
+
+            const int *sync(const Vector<Vector<T> > &x) {
+                if (stale < x._size) refresh(x);
+                return sizes.data();
+            }
+
+            void refresh(const Vector<Vector<T> > &x) {
+                sizes.resize(x._size);
+                for (; stale < x._size; stale++) sizes[stale] = x[stale]._size;
+            }
+        };
+
+        mutable ChunkSizes chunk_sizes;
+
         int _size;
         Vector<Vector<T> > x;
+        // next chunk gc_step() examines
+        int gc_cursor;
     private:
         template<typename Tx, typename Tq>
         class base_iterator {
@@ -205,7 +300,9 @@ namespace sjtu {
     private:
         void init() {
             _size = 0;
-            x.insert(0, Vector<T>());
+            gc_cursor = 0;
+            x.emplace(0);
+            chunk_sizes.invalidate(0);
         }
 
         void throw_if_out_of_bound(int pos, bool include_end = false) const {
@@ -213,6 +310,8 @@ namespace sjtu {
             if (pos < 0 || pos >= size()) throw index_out_of_bound();
         }
 
+        void throw_if_empty() const { if (empty()) throw container_is_empty(); }
+
         template<typename _This, typename Tx>
         static Tx &access(_This *self, int pos) {
             self->throw_if_out_of_bound(pos);
@@ -227,88 +326,108 @@ namespace sjtu {
 
         void split_chunk(int chunk) {
             int split_size = x[chunk].size() >> 1;
-            x.insert(chunk, Vector<T>(Vector<T>::fit(x[chunk]._size)));
+            x.emplace(chunk, Vector<T>::fit(x[chunk]._size));
             auto &chk_a = x[chunk];
             auto &chk_b = x[chunk + 1];
-            memcpy(chk_a.buffer, chk_b.buffer, sizeof(T) * split_size);
+            relocate(chk_a.buffer, chk_b.buffer, split_size);
             chk_a._size = split_size;
-            memmove(chk_b.buffer, chk_b.buffer + split_size, sizeof(T) * (chk_b._size - split_size));
+            relocate(chk_b.buffer, chk_b.buffer + split_size, chk_b._size - split_size);
             chk_b._size -= split_size;
+            chunk_sizes.split(chunk, chk_a._size, chk_b._size);
         }
 
         void merge_chunk(int chunk) {
             auto &chk_a = x[chunk];
             auto &chk_b = x[chunk + 1];
             chk_a.expand_to(Vector<T>::fit(chk_a._size + chk_b._size));
-            memcpy(chk_a.buffer + chk_a._size, chk_b.buffer, sizeof(T) * chk_b._size);
+            relocate(chk_a.buffer + chk_a._size, chk_b.buffer, chk_b._size);
             chk_a._size += chk_b._size;
             chk_b._size = 0;
             x.erase(chunk + 1);
+            chunk_sizes.merged(chunk, x[chunk]._size);
         }
 
-        bool should_split(int total_size) { return total_size >= 16 && total_size * total_size > _size * 8; }
+        // squares of chunk sizes overflow int from 46341 on, so both are compared in long long
+        bool should_split(long long total_size) { return total_size >= 16 && total_size * total_size > _size * 8LL; }
 
-        bool should_merge(int total_size) { return total_size * total_size * 64 <= _size; }
+        bool should_merge(long long total_size) { return total_size * total_size * 64 <= _size; }
 
+        /**
+         * the chunk of pos, pos becoming the offset in it. the end chunk on pos's side is checked in
+         * place, longer walks scan chunk_sizes from the nearer end.
+         */
         int find_at(int &pos) const {
-            int i = 0, _pos = pos, tmp;
-            if (_pos <= _size >> 1) {
-                while (_pos >= (tmp = x[i]._size)) {
-                    if (tmp == 0) {
-                        ++i;
-                        continue;
-                    }
-                    _pos -= tmp;
-                    ++i;
-                }
-            } else {
-                i = x._size - 1;
-                _pos = _size - _pos;
-                while (_pos > (tmp = x[i]._size)) {
-                    if (tmp == 0) {
-                        --i;
-                        continue;
-                    }
-                    _pos -= tmp;
-                    --i;
-                }
-                _pos = x[i]._size - _pos;
+            int n = x._size;
+            if (pos <= _size >> 1) {
+                if (pos < x[0]._size) return 0;
+                return scan_forward(chunk_sizes.sync(x), n, pos, true);
+            }
+            int left = _size - pos;
+            if (left <= x[n - 1]._size) {
+                pos = x[n - 1]._size - left;
+                return n - 1;
             }
-            pos = _pos;
+            const int *sizes = chunk_sizes.sync(x);
+            int i = scan_backward(sizes, n, left, false);
+            pos = sizes[i] - left;
             return i;
         }
 
+        // like find_at, but a position between two chunks is the end of the first one
         int find_at_allow_end(int &pos) const {
-            int i = 0, _pos = pos, tmp;
-            if (_pos <= _size >> 1) {
-                while (_pos > (tmp = x[i].size())) {
-                    _pos -= tmp;
-                    ++i;
-                }
-            } else {
-                i = x.size() - 1;
-                _pos = _size - _pos;
-                while (i != 0 && _pos >= (tmp = x[i].size())) {
-                    _pos -= tmp;
-                    --i;
-                }
-                _pos = x[i].size() - _pos;
+            int n = x._size;
+            if (pos <= _size >> 1) {
+                if (pos <= x[0]._size) return 0;
+                return scan_forward(chunk_sizes.sync(x), n, pos, false);
+            }
+            int left = _size - pos;
+            if (n == 1 || left < x[n - 1]._size) {
+                pos = x[n - 1]._size - left;
+                return n - 1;
             }
-            pos = _pos;
+            const int *sizes = chunk_sizes.sync(x);
+            int i = scan_backward(sizes, n, left, true);
+            pos = sizes[i] - left;
             return i;
         }
 
-        int insert_at(int pos, const T &value) {
+        template<class... Args>
+        int emplace_at(int pos, Args &&... args) {
             throw_if_out_of_bound(pos, true);
             int __pos = pos;
             int i = find_at_allow_end(pos);
-            x[i].insert(pos, value);
+            x[i].emplace(pos, std::forward<Args>(args)...);
+            chunk_sizes.resized(i, x[i]._size);
             ++_size;
             if (should_split(x[i].size())) split_chunk(i);
-            if (rand() < INSERT_GC_THRESHOLD) gc();
+            gc_step();
             return __pos;
         }
 
+        /**
+         * a bounded share of gc(): examines GC_STEP chunks from gc_cursor on, erasing it when
+         * empty, splitting it when too large or merging it with the next one when both are small.
+         * the cursor sweeps every chunk once per x.size() / GC_STEP operations, so chunks are
+         * rebalanced at a steady, deterministic cost instead of in one random pause.
+         */
+        void gc_step() {
+            for (int k = 0; k < GC_STEP; k++) {
+                if (gc_cursor >= x.size()) gc_cursor = 0;
+                int i = gc_cursor;
+                if (x[i].size() == 0 && i != x.size() - 1) {
+                    x.erase(i);
+                    chunk_sizes.erased(i);
+                } else if (should_split(x[i].size())) {
+                    split_chunk(i);
+                    gc_cursor += 2;
+                } else if (i != x.size() - 1 && should_merge(x[i].size() + x[i + 1].size())) {
+                    merge_chunk(i);
+                } else {
+                    ++gc_cursor;
+                }
+            }
+        }
+
     public:
         void gc() {
             clear_zero();
@@ -330,10 +449,11 @@ namespace sjtu {
 
         void clear_zero() {
             if (x.size() <= 1) return;
-            for (int i = 0; i < x.size() - 1; i++) {
-                if (x[i].size() == 0) {
-                    x.erase(i);
-                }
+            chunk_sizes.invalidate(0);
+            // the chunk moved into slot i by an erase is checked too
+            for (int i = 0; i < x.size() - 1;) {
+                if (x[i].size() == 0) x.erase(i);
+                else ++i;
             }
         }
 
@@ -342,16 +462,121 @@ namespace sjtu {
             int __pos = pos;
             int i = find_at(pos);
             x[i].erase(pos);
+            chunk_sizes.resized(i, x[i]._size);
             --_size;
             if (i != x.size() - 1) {
                 if (should_merge(x[i].size() + x[i + 1].size())) merge_chunk(i);
             } else {
-                if (x.size() > 1 && x[i].size() == 0) x.erase(i);
+                if (x.size() > 1 && x[i].size() == 0) {
+                    x.erase(i);
+                    chunk_sizes.erased(i);
+                }
             }
-            if (rand() < REMOVE_GC_THRESHOLD) gc();
+            gc_step();
             return __pos;
         }
 
+        /**
+         * inserts n elements before pos, fill(slot) constructing each of them in order.
+         * when the chunk stays below the split threshold the gap is opened in place, otherwise the
+         * chunk is cut at pos and the elements go into fresh chunks of about sqrt(2 * size), so the
+         * cost is the elements moved plus the chunks shifted rather than n lookups.
+         */
+        template<class Fill>
+        int insert_n(int pos, int n, Fill &fill) {
+            throw_if_out_of_bound(pos, true);
+            if (n <= 0) return pos;
+            int offset = pos;
+            int i = find_at_allow_end(offset);
+            chunk_sizes.invalidate(i);
+            // _size follows every constructed element, so a throwing fill leaves a consistent deque
+            auto put = [&](T *slot) {
+                fill(slot);
+                ++_size;
+            };
+            if (!should_split(x[i].size() + n)) {
+                x[i].fill_n(offset, n, put);
+                gc_step();
+                return pos;
+            }
+            int tail = x[i].size() - offset;
+            // the new chunks go after chunk i, unless pos is at its very front
+            int at = offset == 0 && tail > 0 ? i : i + 1;
+            if (offset > 0 && tail > 0) {
+                x.emplace(i + 1, Vector<T>::fit(tail));
+                relocate(x[i + 1].buffer, x[i].buffer + offset, tail);
+                x[i + 1]._size = tail;
+                x[i]._size = offset;
+            }
+            int chunk = std::max(16, int(std::sqrt(2.0 * (_size + n))));
+            int k = (n + chunk - 1) / chunk;
+            auto make = [&](Vector<T> *slot) { ::new((void *) slot) Vector<T>(Vector<T>::fit(chunk)); };
+            x.fill_n(at, k, make);
+            int j = at;
+            try {
+                for (int left = n; left > 0; left -= chunk, j++) x[j].fill_n(0, std::min(left, chunk), put);
+            } catch (...) {
+                x.erase(x[j].size() ? j + 1 : j, at + k);
+                if (x.size() > 1 && x[i].size() == 0) x.erase(i);
+                throw;
+            }
+            // the only chunk of an empty deque, now redundant
+            if (x[i].size() == 0) {
+                x.erase(i);
+                --at;
+            }
+            if (offset > 0 && should_merge(x[at - 1].size() + x[at].size())) {
+                merge_chunk(at - 1);
+                --at;
+            }
+            int last = at + k - 1;
+            if (last + 1 < x.size() && should_merge(x[last].size() + x[last + 1].size())) merge_chunk(last);
+            gc_step();
+            return pos;
+        }
+
+        /**
+         * removes the n elements from pos on: trims the first and the last chunk of the range,
+         * drops the chunks in between whole and rebalances the seam once.
+         */
+        int remove_n(int pos, int n) {
+            if (n <= 0) return pos;
+            int from = pos, to = pos + n;
+            int a = find_at(from);
+            int b = find_at_allow_end(to);
+            chunk_sizes.invalidate(a);
+            if (a == b) {
+                x[a].erase(from, to);
+            } else {
+                x[a].erase(from, x[a].size());
+                x[b].erase(0, to);
+                x.erase(a + 1, b);
+                if (x[a + 1].size() == 0) x.erase(a + 1);
+            }
+            _size -= n;
+            if (x.size() > 1 && x[a].size() == 0) x.erase(a);
+            else if (a + 1 < x.size() && should_merge(x[a].size() + x[a + 1].size())) merge_chunk(a);
+            gc_step();
+            return pos;
+        }
+
+        template<class ForwardIt>
+        int insert_range(int pos, ForwardIt first, ForwardIt last, std::forward_iterator_tag) {
+            auto fill = [&](T *slot) {
+                ::new((void *) slot) T(*first);
+                ++first;
+            };
+            return insert_n(pos, int(std::distance(first, last)), fill);
+        }
+
+        // a single pass range is buffered first, its length is needed up front
+        template<class InputIt>
+        int insert_range(int pos, InputIt first, InputIt last, std::input_iterator_tag) {
+            std::vector<T> buffer(first, last);
+            return insert_range(pos, std::make_move_iterator(buffer.begin()), std::make_move_iterator(buffer.end()),
+                                std::forward_iterator_tag());
+        }
+
     public:
         typedef base_iterator<T, deque> iterator;
         typedef base_iterator<const T, const deque> const_iterator;
@@ -364,6 +589,24 @@ namespace sjtu {
             init();
         }
 
+        /**
+         * builds the deque from [first, last), or from count copies of value, in chunks of about
+         * sqrt(2 * size) laid out directly.
+         */
+        template<class InputIt, class = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+        deque(InputIt first, InputIt last) {
+            _size = 0;
+            init();
+            insert_range(0, first, last, typename std::iterator_traits<InputIt>::iterator_category());
+        }
+
+        deque(size_t count, const T &value) {
+            _size = 0;
+            init();
+            auto fill = [&](T *slot) { ::new((void *) slot) T(value); };
+            insert_n(0, int(count), fill);
+        }
+
         /**
          * Deconstructor
          */
@@ -385,13 +628,19 @@ namespace sjtu {
          * access the first element
          * throw container_is_empty when the container is empty.
          */
-        const T &front() const { return access(0); }
+        const T &front() const {
+            throw_if_empty();
+            return access(0);
+        }
 
         /**
          * access the last element
          * throw container_is_empty when the container is empty.
          */
-        const T &back() const { return access(size() - 1); }
+        const T &back() const {
+            throw_if_empty();
+            return access(size() - 1);
+        }
 
         /**
          * returns an iterator to the beginning.
@@ -417,6 +666,9 @@ namespace sjtu {
          */
         size_t size() const { return _size; }
 
+        // the number of chunks, to check their layout from outside
+        size_t chunk_count() const { return x.size(); }
+
         /**
          * clears the contents
          */
@@ -425,15 +677,70 @@ namespace sjtu {
             init();
         }
 
+        /**
+         * replaces the contents with [first, last), laid out like deque(first, last)
+         */
+        template<class InputIt, class = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+        void assign(InputIt first, InputIt last) {
+            clear();
+            insert_range(0, first, last, typename std::iterator_traits<InputIt>::iterator_category());
+        }
+
+        /**
+         * replaces the contents with count copies of value
+         */
+        void assign(size_t count, const T &value) {
+            // value may be an element of this deque
+            T copy(value);
+            clear();
+            auto fill = [&](T *slot) { ::new((void *) slot) T(copy); };
+            insert_n(0, int(count), fill);
+        }
+
         /**
          * inserts elements at the specified locat on in the container.
          * inserts value before pos
          * returns an iterator pointing to the inserted value
          *     throw if the iterator is invalid or it point to a wrong place.
          */
-        iterator insert(iterator pos, const T &value) {
+        iterator insert(iterator pos, const T &value) { return emplace(pos, value); }
+
+        iterator insert(iterator pos, T &&value) { return emplace(pos, std::move(value)); }
+
+        /**
+         * constructs an element from args in place before pos.
+         * returns an iterator pointing to the new element
+         *     throw if the iterator is invalid or it point to a wrong place.
+         */
+        template<class... Args>
+        iterator emplace(iterator pos, Args &&... args) {
+            pos.check_owns(this);
+            return iterator(this, emplace_at(pos.pos, std::forward<Args>(args)...));
+        }
+
+        /**
+         * inserts count copies of value before pos.
+         * returns an iterator pointing to the first inserted value (pos itself when count is 0)
+         *     throw if the iterator is invalid or it point to a wrong place.
+         */
+        iterator insert(iterator pos, size_t count, const T &value) {
+            pos.check_owns(this);
+            // value may be an element of this deque, which the insertion moves
+            T copy(value);
+            auto fill = [&](T *slot) { ::new((void *) slot) T(copy); };
+            return iterator(this, insert_n(pos.pos, int(count), fill));
+        }
+
+        /**
+         * inserts the elements of [first, last) before pos.
+         * returns an iterator pointing to the first inserted value (pos itself when the range is empty)
+         *     throw if the iterator is invalid or it point to a wrong place.
+         */
+        template<class InputIt, class = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+        iterator insert(iterator pos, InputIt first, InputIt last) {
             pos.check_owns(this);
-            return iterator(this, insert_at(pos.pos, value));
+            return iterator(this, insert_range(pos.pos, first, last,
+                                               typename std::iterator_traits<InputIt>::iterator_category()));
         }
 
         /**
@@ -447,27 +754,63 @@ namespace sjtu {
             return iterator(this, remove_at(pos.pos));
         }
 
+        /**
+         * removes the elements in [first, last).
+         * returns an iterator pointing to the element that followed the removed range.
+         *     throw if an iterator is invalid, points to a wrong place or first comes after last.
+         */
+        iterator erase(iterator first, iterator last) {
+            first.check_owns(this);
+            last.check_owns(this);
+            throw_if_out_of_bound(first.pos, true);
+            throw_if_out_of_bound(last.pos, true);
+            if (first.pos > last.pos) throw invalid_iterator();
+            return iterator(this, remove_n(first.pos, last.pos - first.pos));
+        }
+
         /**
          * adds an element to the end
          */
-        void push_back(const T &value) { insert_at(size(), value); }
+        void push_back(const T &value) { emplace_at(size(), value); }
+
+        void push_back(T &&value) { emplace_at(size(), std::move(value)); }
+
+        /**
+         * constructs an element from args in place at the end
+         */
+        template<class... Args>
+        void emplace_back(Args &&... args) { emplace_at(size(), std::forward<Args>(args)...); }
 
         /**
          * removes the last element
          *     throw when the container is empty.
          */
-        void pop_back() { remove_at(size() - 1); }
+        void pop_back() {
+            throw_if_empty();
+            remove_at(size() - 1);
+        }
 
         /**
          * inserts an element to the beginning.
          */
-        void push_front(const T &value) { insert_at(0, value); }
+        void push_front(const T &value) { emplace_at(0, value); }
+
+        void push_front(T &&value) { emplace_at(0, std::move(value)); }
+
+        /**
+         * constructs an element from args in place at the beginning
+         */
+        template<class... Args>
+        void emplace_front(Args &&... args) { emplace_at(0, std::forward<Args>(args)...); }
 
         /**
          * removes the first element.
          *     throw when the container is empty.
          */
-        void pop_front() { remove_at(0); }
+        void pop_front() {
+            throw_if_empty();
+            remove_at(0);
+        }
 
         void debug() const {
             std::cerr << _size << "(" << x.size() << "): ";
@@ -3,11 +3,24 @@
 
 #include "exceptions.hpp"
 #include "utility.hpp"
+#include "relocation.hpp"
+#include "chunk_pool.hpp"
 
 #include <cstddef>
+#include <cstdlib>
+#include <cmath>
+#include <iterator>
+#include <type_traits>
 #include <memory>
+#include <utility>
 #include <vector>
 #include <iostream>
+#include <algorithm>
+
+// every buffer and node is allocated through this, define it before including to hook allocations
+#ifndef SJTU_DEQUE_ALLOCATOR
+#define SJTU_DEQUE_ALLOCATOR std::allocator
+#endif
 
 #define LSB(i) ((i) & -(i))
 
@@ -15,16 +28,22 @@ namespace sjtu {
     template<class T>
     class deque {
     private:
-        static const int INSERT_GC_THRESHOLD = 10000;
-        static const int REMOVE_GC_THRESHOLD = 10000;
+        // chunks gc_step() examines per insert / remove
+        static const int GC_STEP = 2;
+        // chunks a lookup walks from a finger before it descends the tree instead
+        static const int FINGER_REACH = 4;
 
         template<class U>
         class Vector {
+        public:
+            // a Vector only owns its buffer through a pointer, moving its bytes is enough
+            typedef std::true_type trivially_relocatable;
+        private:
             static const int min_chunk_size = 512;
             friend deque;
             U *buffer;
             int _size, _cap;
-            std::allocator<U> alloc;
+            pooled_allocator<U> alloc;
 
             bool full() { return _size == _cap; }
 
@@ -36,7 +55,7 @@ namespace sjtu {
 
             void expand_to(int new_cap) {
                 U *new_buffer = alloc.allocate(new_cap);
-                memcpy(new_buffer, buffer, sizeof(U) * _size);
+                relocate(new_buffer, buffer, _size);
                 alloc.deallocate(buffer, _cap);
                 _cap = new_cap;
                 buffer = new_buffer;
@@ -48,7 +67,7 @@ namespace sjtu {
 
             void expand_if_full() {
                 if (!full()) return;
-                expand_to(_cap << 1);
+                expand_to(fit(_cap + 1));
             }
 
             U *get_buffer() {
@@ -78,20 +97,48 @@ namespace sjtu {
 
             int size() const { return _size; }
 
-            void insert(int pos, const U &x) {
+            // constructs an element from args right in the gap opened at pos
+            template<class... Args>
+            void emplace(int pos, Args &&... args) {
                 expand_if_full();
-                if (pos != _size) memmove(buffer + pos + 1, buffer + pos, (_size - pos) * sizeof(U));
-                alloc.construct(buffer + pos, x);
+                if (pos != _size) relocate(buffer + pos + 1, buffer + pos, _size - pos);
+                alloc.construct(buffer + pos, std::forward<Args>(args)...);
                 ++_size;
             }
 
+            /**
+             * opens a gap of n at pos and lets fill(slot) construct the new elements in order.
+             * if fill throws, the gap closes over the slots not yet filled.
+             */
+            template<class Fill>
+            void fill_n(int pos, int n, Fill &fill) {
+                if (_size + n > _cap) expand_to(fit(_size + n));
+                relocate(buffer + pos + n, buffer + pos, _size - pos);
+                int done = 0;
+                try {
+                    for (; done < n; done++) fill(buffer + pos + done);
+                } catch (...) {
+                    relocate(buffer + pos + done, buffer + pos + n, _size - pos);
+                    _size += done;
+                    throw;
+                }
+                _size += n;
+            }
+
             void erase(int pos) {
                 alloc.destroy(buffer + pos);
-                if (pos != _size - 1) memmove(buffer + pos, buffer + pos + 1, (_size - pos - 1) * sizeof(U));
+                if (pos != _size - 1) relocate(buffer + pos, buffer + pos + 1, _size - pos - 1);
                 --_size;
                 shrink_if_small();
             }
 
+            void erase(int from, int to) {
+                for (int i = from; i < to; i++) alloc.destroy(buffer + i);
+                relocate(buffer + from, buffer + to, _size - to);
+                _size -= to - from;
+                shrink_if_small();
+            }
+
             void clear() {
                 for (int i = 0; i < _size; i++) alloc.destroy(buffer + i);
                 _size = 0;
@@ -109,16 +156,23 @@ namespace sjtu {
 
         int _size;
         Vector< Vector<T> > x;
+        // next chunk gc_step() examines
+        int gc_cursor;
+        // bumped by every change to the layout, iterators holding an older stamp look their position up again
+        unsigned long long version;
     private:
         template<typename Tx, typename Tq>
         class base_iterator {
         protected:
             friend deque;
             Tq *q;
-            mutable Tx *elem;
             int pos;
+            // where pos sits in q, trusted only while stamp equals q->version
+            mutable int chunk, offset;
+            mutable Tx *elem;
+            mutable unsigned long long stamp;
 
-            base_iterator(Tq *q, const int &pos) : q(q), pos(pos), elem(NULL) {}
+            base_iterator(Tq *q, const int &pos) : q(q), pos(pos), chunk(0), offset(0), elem(nullptr), stamp(0) {}
 
             bool owns(Tq *q) const { return q == this->q; }
 
@@ -131,17 +185,47 @@ namespace sjtu {
                 return *self;
             }
 
-            base_iterator &construct() {
-                elem = nullptr;
-                return valid<base_iterator>(this);
+            bool resolved() const { return stamp == q->version; }
+
+            // looks pos up again after the deque changed, end() resolves to the end of the last chunk
+            void resolve() const {
+                if (pos < 0 || pos > int(q->size())) {
+                    elem = nullptr;
+                    stamp = 0;
+                    return;
+                }
+                offset = pos;
+                chunk = q->find_at_allow_end(offset);
+                // find_at_allow_end puts a chunk boundary at the end of the earlier chunk
+                while (offset == q->x[chunk].size() && chunk + 1 < q->x.size()) {
+                    ++chunk;
+                    offset = 0;
+                }
+                point();
+                stamp = q->version;
             }
 
-            const base_iterator &construct() const {
-                elem = nullptr;
-                return valid<const base_iterator>(this);
+            void point() const { elem = offset < q->x[chunk].size() ? &q->x[chunk][offset] : nullptr; }
+
+            // moves a resolved iterator by n inside its chunk, otherwise leaves it to resolve()
+            void seek(int n) const {
+                if (!resolved()) return;
+                int to = offset + n;
+                if (to >= 0 && to < q->x[chunk].size()) {
+                    offset = to;
+                    point();
+                } else {
+                    stamp = 0;
+                }
             }
 
         public:
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef typename std::remove_const<Tx>::type value_type;
+            typedef int difference_type;
+            typedef Tx *pointer;
+            typedef Tx &reference;
+
             base_iterator(const base_iterator &that) = default;
 
             base_iterator() : base_iterator(nullptr, 0) {}
@@ -151,21 +235,32 @@ namespace sjtu {
              *   even if there are not enough elements, the behaviour is **undefined**.
              * as well as operator-
              */
-            base_iterator operator+(const int &n) const { return base_iterator(q, pos + n).construct(); }
+            base_iterator operator+(const int &n) const {
+                base_iterator that = *this;
+                return that += n;
+            }
 
-            base_iterator operator-(const int &n) const { return base_iterator(q, pos - n).construct(); }
+            base_iterator operator-(const int &n) const {
+                base_iterator that = *this;
+                return that -= n;
+            }
 
             // return th distance between two iterator,
             // if these two iterators points to different vectors, throw invaild_iterator.
             int operator-(const base_iterator &rhs) const {
-                construct();
+                valid(this);
                 check_owns(rhs.q);
                 return pos - rhs.pos;
             }
 
-            base_iterator &operator+=(const int &n) { return *this = base_iterator(q, pos + n).construct(); }
+            base_iterator &operator+=(const int &n) {
+                pos += n;
+                valid(this);
+                seek(n);
+                return *this;
+            }
 
-            base_iterator &operator-=(const int &n) { return *this = base_iterator(q, pos - n).construct(); }
+            base_iterator &operator-=(const int &n) { return *this += -n; }
 
             base_iterator operator++(int) {
                 auto _ = *this;
@@ -175,7 +270,15 @@ namespace sjtu {
 
             base_iterator &operator++() {
                 ++pos;
-                return construct();
+                valid(this);
+                if (!resolved()) return *this;
+                ++offset;
+                while (offset == q->x[chunk].size() && chunk + 1 < q->x.size()) {
+                    ++chunk;
+                    offset = 0;
+                }
+                point();
+                return *this;
             }
 
             base_iterator operator--(int) {
@@ -186,18 +289,21 @@ namespace sjtu {
 
             base_iterator &operator--() {
                 --pos;
-                return construct();
+                valid(this);
+                if (!resolved()) return *this;
+                while (offset == 0) offset = q->x[--chunk].size();
+                --offset;
+                point();
+                return *this;
             }
 
             Tx &operator*() const {
-                if (!elem) elem = &q->access(pos);
+                if (!resolved()) resolve();
+                if (!elem) throw index_out_of_bound();
                 return *elem;
             }
 
-            Tx *operator->() const noexcept {
-                if (!elem) elem = &q->access(pos);
-                return elem;
-            }
+            Tx *operator->() const noexcept { return &**this; }
 
             bool operator==(const base_iterator &rhs) const { return rhs.q == q && rhs.pos == pos; }
 
@@ -205,14 +311,64 @@ namespace sjtu {
         };
     public:
 
+        /**
+         * fenwick tree over the chunk sizes, entries 1..n for n chunks.
+         * a deque with a single chunk needs no index, so the table is only allocated once there
+         * are two chunks, and refresh() resizes it to the chunk count.
+         *
+         * splitting, merging or erasing chunk i shifts every later chunk, so it only marks the
+         * entries above i stale (invalidate); the next lookup rebuilds that suffix in linear time.
+         */
         class Cache {
         public:
-            const static int MAX_CACHE_SIZE = 4096;
-            unsigned int A[MAX_CACHE_SIZE];
+            static const int min_cache_size = 16;
+            size_t *A;
+            int cap;
+            // entries 1..clean are up to date
+            int clean;
+            SJTU_DEQUE_ALLOCATOR<size_t> alloc;
+
+            void release() {
+                if (A) alloc.deallocate(A, cap);
+                A = nullptr;
+                cap = 0;
+            }
+
+            // makes room for n chunks, shrinking when the table is four times too large.
+            // returns whether the table was reallocated, which loses every entry
+            bool reserve(int n) {
+                int want = min_cache_size;
+                while (want < n + 1) want <<= 1;
+                if (A && want <= cap && want * 4 > cap) return false;
+                release();
+                A = alloc.allocate(want);
+                cap = want;
+                return true;
+            }
 
-            int sum(int i) const {
+            /**
+             * recomputes entries clean+1..n from the chunk sizes of q.
+             * entries up to clean are kept; the clean nodes whose parent lies above clean are
+             * exactly those on the prefix path of clean, so pushing them up and then every stale
+             * node into its parent (in increasing order) rebuilds the suffix in O(n - clean + log n).
+             */
+            void rebuild_suffix(const deque &q, int n) {
+                for (int j = clean + 1; j <= n; j++) A[j] = q.x[j - 1].size();
+                for (int c = clean; c > 0; c -= LSB(c)) {
+                    int p = c + LSB(c);
+                    if (p <= n) A[p] += A[c];
+                }
+                for (int j = clean + 1; j <= n; j++) {
+                    int p = j + LSB(j);
+                    if (p <= n) A[p] += A[j];
+                }
+                clean = n;
+            }
+
+            size_t sum(int i) const {
                 ++i;
-                int sum = 0;
+                size_t sum = 0;
+                if (!A) return 0;
                 while (i > 0) {
                     sum += A[i];
                     i -= LSB(i);
@@ -220,21 +376,52 @@ namespace sjtu {
                 return sum;
             }
 
-            void add(int i, int k, int _size) {
+            // chunk i changed its size by k, entries above clean are left to the next refresh
+            void add(int i, long long k) {
+                if (!A) return;
                 ++i;
-                while (i < MAX_CACHE_SIZE) {
+                while (i <= clean) {
                     A[i] += k;
                     i += LSB(i);
                 }
             }
 
-            void rebuild(const deque& q) {
-                memset(A, 0, sizeof A);
-                int __size = q.x.size();
-                for (int i = 0; i < __size; i++) {
-                    add(i, q.x[i].size(), __size);
+            // chunks from i on were split, merged or erased
+            void invalidate(int i) { clean = std::min(clean, i); }
+
+            void refresh(const deque &q) {
+                int n = q.x.size();
+                if (n <= 1) {
+                    release();
+                    clean = n;
+                    return;
+                }
+                if (clean >= n && A) return;
+                if (reserve(n)) clean = 0;
+                rebuild_suffix(q, n);
+            }
+
+            /**
+             * walks the tree top-down over the first n chunks in one pass, returns the chunk
+             * holding element pos and leaves the offset inside that chunk in pos.
+             * with allow_end a pos on a chunk boundary goes to the end of the earlier chunk.
+             */
+            int descend(int &pos, int n, bool allow_end) const {
+                if (!A) return 0;
+                int i = 0, step = 1;
+                while ((step << 1) <= n) step <<= 1;
+                for (; step; step >>= 1) {
+                    int j = i + step;
+                    if (j > n) continue;
+                    size_t s = A[j];
+                    if (allow_end ? s < size_t(pos) : s <= size_t(pos)) {
+                        i = j;
+                        pos -= int(s);
+                    }
                 }
+                return i;
             }
+
             void debug(int n) const {
                 for (int i = 0; i < n; i++) {
                     std::cerr << this->sum(i) << " ";
@@ -242,15 +429,41 @@ namespace sjtu {
                 std::cerr << std::endl;
             }
 
-            Cache() {
-                memset(A, 0, sizeof A);
+            Cache() : A(nullptr), cap(0), clean(0) {}
+
+            Cache(const Cache &that) : A(nullptr), cap(0), clean(0) { *this = that; }
+
+            Cache &operator=(const Cache &that) {
+                if (this == &that) return *this;
+                release();
+                clean = that.clean;
+                if (!that.A) return *this;
+                A = alloc.allocate(that.cap);
+                cap = that.cap;
+                memcpy(A, that.A, sizeof(size_t) * cap);
+                return *this;
             }
-        } map_cache;
+
+            ~Cache() { release(); }
+        };
+
+        // refreshed lazily by the (const) lookups
+        mutable Cache map_cache;
+
+        // a chunk and the index of its first element, trusted while stamp equals version
+        struct finger {
+            int chunk, start;
+            unsigned long long stamp;
+        };
+
+        // where the last two lookups by index landed, the latest first
+        mutable finger fingers[2] = {};
 
     private:
         void init() {
             _size = 0;
-            x.insert(0, Vector<T>());
+            gc_cursor = 0;
+            x.emplace(0);
         }
 
         void throw_if_out_of_bound(int pos, bool include_end = false) const {
@@ -258,11 +471,12 @@ namespace sjtu {
             if (pos < 0 || pos >= size()) throw index_out_of_bound();
         }
 
+        void throw_if_empty() const { if (empty()) throw container_is_empty(); }
+
         template<typename _This, typename Tx>
         static Tx &access(_This *self, int pos) {
             self->throw_if_out_of_bound(pos);
-            int _pos = pos;
-            int i = self->find_at(pos);
+            int i = self->find_near(pos);
             return self->x[i][pos];
         }
 
@@ -272,12 +486,12 @@ namespace sjtu {
 
         void split_chunk(int chunk) {
             int split_size = x[chunk].size() >> 1;
-            x.insert(chunk, Vector<T>(Vector<T>::fit(x[chunk]._size)));
+            x.emplace(chunk, Vector<T>::fit(x[chunk]._size));
             auto &chk_a = x[chunk];
             auto &chk_b = x[chunk + 1];
-            memcpy(chk_a.buffer, chk_b.buffer, sizeof(T) * split_size);
+            relocate(chk_a.buffer, chk_b.buffer, split_size);
             chk_a._size = split_size;
-            memmove(chk_b.buffer, chk_b.buffer + split_size, sizeof(T) * (chk_b._size - split_size));
+            relocate(chk_b.buffer, chk_b.buffer + split_size, chk_b._size - split_size);
             chk_b._size -= split_size;
         }
 
@@ -285,15 +499,16 @@ namespace sjtu {
             auto &chk_a = x[chunk];
             auto &chk_b = x[chunk + 1];
             chk_a.expand_to(Vector<T>::fit(chk_a._size + chk_b._size));
-            memcpy(chk_a.buffer + chk_a._size, chk_b.buffer, sizeof(T) * chk_b._size);
+            relocate(chk_a.buffer + chk_a._size, chk_b.buffer, chk_b._size);
             chk_a._size += chk_b._size;
             chk_b._size = 0;
             x.erase(chunk + 1);
         }
 
-        bool should_split(int total_size) { return total_size >= 16 && total_size * total_size > _size * 8; }
+        // squares of chunk sizes overflow int from 46341 on, so both are compared in long long
+        bool should_split(long long total_size) { return total_size >= 16 && total_size * total_size > _size * 8LL; }
 
-        bool should_merge(int total_size) { return total_size * total_size * 64 <= _size; }
+        bool should_merge(long long total_size) { return total_size * total_size * 64 <= _size; }
 
         int find_at(int &pos) const {
             if (pos == 0) return 0;
@@ -301,19 +516,8 @@ namespace sjtu {
                 pos = x[x.size() - 1].size() + pos - _size;
                 return x.size() - 1;
             }
-            int L = 0, R = x.size();
-            int M = 0;
-            while (L < R) {
-                M = (L + R) >> 1;
-                if (map_cache.sum(M - 1) <= pos) {
-                    L = M + 1;
-                } else {
-                    R = M;
-                }
-            }
-            --L;
-            pos -= map_cache.sum(L - 1);
-            return L;
+            map_cache.refresh(*this);
+            return map_cache.descend(pos, x.size(), false);
         }
 
         int find_at_allow_end(int &pos) const {
@@ -322,88 +526,223 @@ namespace sjtu {
                 pos = x[x.size() - 1].size() + pos - _size;
                 return x.size() - 1;
             }
-            int L = 0, R = x.size();
-            int M = 0;
-            while (L < R) {
-                M = (L + R) >> 1;
-                if (map_cache.sum(M - 1) < pos) {
-                    L = M + 1;
+            map_cache.refresh(*this);
+            return map_cache.descend(pos, x.size(), true);
+        }
+
+        /**
+         * moves f to the chunk holding pos if that is at most FINGER_REACH chunks away.
+         * a pos farther than FINGER_REACH times the size of f's chunk is given up on right away.
+         */
+        bool walk(finger &f, int pos) const {
+            if (std::abs(pos - f.start) > FINGER_REACH * x[f.chunk].size()) return false;
+            for (int steps = 0;; steps++) {
+                bool before = pos < f.start;
+                if (!before && pos - f.start < x[f.chunk].size()) return true;
+                if (steps == FINGER_REACH) return false;
+                if (before) {
+                    if (f.chunk == 0) return false;
+                    f.start -= x[--f.chunk].size();
                 } else {
-                    R = M;
+                    if (f.chunk + 1 == x.size()) return false;
+                    f.start += x[f.chunk++].size();
                 }
             }
-            --L;
-            pos -= map_cache.sum(L - 1);
-            return L;
         }
 
-        int insert_at(int pos, const T &value) {
+        /**
+         * find_at for access(): a pos near one of the fingers is reached by walking from it, so
+         * sequential lookups and lookups alternating between two places skip the tree.
+         * the chunk found becomes the latest finger.
+         */
+        int find_near(int &pos) const {
+            int k = 0;
+            finger f;
+            for (; k < 2; k++) {
+                f = fingers[k];
+                if (f.stamp == version && walk(f, pos)) break;
+            }
+            if (k == 2) {
+                int offset = pos;
+                f.chunk = find_at(offset);
+                f.start = pos - offset;
+                f.stamp = version;
+                k = 1;
+            }
+            fingers[k] = fingers[0];
+            fingers[0] = f;
+            pos -= f.start;
+            return f.chunk;
+        }
+
+        template<class... Args>
+        int emplace_at(int pos, Args &&... args) {
             throw_if_out_of_bound(pos, true);
+            ++version;
             int __pos = pos;
             int i = find_at_allow_end(pos);
-            x[i].insert(pos, value);
-            map_cache.add(i, 1, x.size() + 1);
+            x[i].emplace(pos, std::forward<Args>(args)...);
+            map_cache.add(i, 1);
             ++_size;
             if (should_split(x[i].size())) {
                 split_chunk(i);
-                map_cache.rebuild(*this);
-            }
-            if (rand() < INSERT_GC_THRESHOLD) {
-                gc();
-                map_cache.rebuild(*this);
+                map_cache.invalidate(i);
             }
+            gc_step();
             return __pos;
         }
 
-        void gc() {
-            clear_zero();
-            for (int i = 0; i < x.size(); i++) {
-                if (should_split(x[i].size())) {
+        /**
+         * rebalancing in bounded steps: examines GC_STEP chunks from gc_cursor on, erasing a chunk when
+         * empty, splitting it when too large or merging it with the next one when both are small.
+         * the cursor sweeps every chunk once per x.size() / GC_STEP operations, so chunks are
+         * rebalanced at a steady, deterministic cost instead of in one random pause.
+         */
+        void gc_step() {
+            for (int k = 0; k < GC_STEP; k++) {
+                if (gc_cursor >= x.size()) gc_cursor = 0;
+                int i = gc_cursor;
+                if (x[i].size() == 0 && i != x.size() - 1) {
+                    x.erase(i);
+                    map_cache.invalidate(i);
+                } else if (should_split(x[i].size())) {
                     split_chunk(i);
-                    ++i;
-                }
-            }
-            for (int i = 0; i < x.size() - 1; i++) {
-                if (should_merge(x[i].size() + x[i + 1].size())) {
+                    map_cache.invalidate(i);
+                    gc_cursor += 2;
+                } else if (i != x.size() - 1 && should_merge(x[i].size() + x[i + 1].size())) {
                     merge_chunk(i);
-                    --i;
-                }
-            }
-        }
-
-        void clear_zero() {
-            if (x.size() <= 1) return;
-            for (int i = 0; i < x.size() - 1; i++) {
-                if (x[i].size() == 0) {
-                    x.erase(i);
+                    map_cache.invalidate(i);
+                } else {
+                    ++gc_cursor;
                 }
             }
         }
 
         int remove_at(int pos) {
             throw_if_out_of_bound(pos);
+            ++version;
             int __pos = pos;
             int i = find_at(pos);
             x[i].erase(pos);
-            map_cache.add(i, -1, x.size() + 1);
+            map_cache.add(i, -1);
             --_size;
             if (i != x.size() - 1) {
                 if (should_merge(x[i].size() + x[i + 1].size())) {
                     merge_chunk(i);
-                    map_cache.rebuild(*this);
+                    map_cache.invalidate(i);
                 }
             }
             if (x.size() > 1 && x[i].size() == 0) {
                 x.erase(i);
-                map_cache.rebuild(*this);
-            }
-            if (rand() < REMOVE_GC_THRESHOLD) {
-                gc();
-                map_cache.rebuild(*this);
+                map_cache.invalidate(i);
             }
+            gc_step();
             return __pos;
         }
 
+        /**
+         * inserts n elements before pos, fill(slot) constructing each of them in order.
+         * when the chunk stays below the split threshold the gap is opened in place, otherwise the
+         * chunk is cut at pos and the elements go into fresh chunks of about sqrt(2 * size), so the
+         * cost is the elements moved plus the chunks shifted rather than n lookups.
+         */
+        template<class Fill>
+        int insert_n(int pos, int n, Fill &fill) {
+            throw_if_out_of_bound(pos, true);
+            if (n <= 0) return pos;
+            int offset = pos;
+            int i = find_at_allow_end(offset);
+            ++version;
+            map_cache.invalidate(i);
+            // _size follows every constructed element, so a throwing fill leaves a consistent deque
+            auto put = [&](T *slot) {
+                fill(slot);
+                ++_size;
+            };
+            if (!should_split(x[i].size() + n)) {
+                x[i].fill_n(offset, n, put);
+                gc_step();
+                return pos;
+            }
+            int tail = x[i].size() - offset;
+            // the new chunks go after chunk i, unless pos is at its very front
+            int at = offset == 0 && tail > 0 ? i : i + 1;
+            if (offset > 0 && tail > 0) {
+                x.emplace(i + 1, Vector<T>::fit(tail));
+                relocate(x[i + 1].buffer, x[i].buffer + offset, tail);
+                x[i + 1]._size = tail;
+                x[i]._size = offset;
+            }
+            int chunk = std::max(16, int(std::sqrt(2.0 * (_size + n))));
+            int k = (n + chunk - 1) / chunk;
+            auto make = [&](Vector<T> *slot) { ::new((void *) slot) Vector<T>(Vector<T>::fit(chunk)); };
+            x.fill_n(at, k, make);
+            int j = at;
+            try {
+                for (int left = n; left > 0; left -= chunk, j++) x[j].fill_n(0, std::min(left, chunk), put);
+            } catch (...) {
+                x.erase(x[j].size() ? j + 1 : j, at + k);
+                if (x.size() > 1 && x[i].size() == 0) x.erase(i);
+                throw;
+            }
+            // the only chunk of an empty deque, now redundant
+            if (x[i].size() == 0) {
+                x.erase(i);
+                --at;
+            }
+            if (offset > 0 && should_merge(x[at - 1].size() + x[at].size())) {
+                merge_chunk(at - 1);
+                --at;
+            }
+            int last = at + k - 1;
+            if (last + 1 < x.size() && should_merge(x[last].size() + x[last + 1].size())) merge_chunk(last);
+            gc_step();
+            return pos;
+        }
+
+        /**
+         * removes the n elements from pos on: trims the first and the last chunk of the range,
+         * drops the chunks in between whole and rebalances the seam once.
+         */
+        int remove_n(int pos, int n) {
+            if (n <= 0) return pos;
+            int from = pos, to = pos + n;
+            int a = find_at(from);
+            int b = find_at_allow_end(to);
+            ++version;
+            map_cache.invalidate(a);
+            if (a == b) {
+                x[a].erase(from, to);
+            } else {
+                x[a].erase(from, x[a].size());
+                x[b].erase(0, to);
+                x.erase(a + 1, b);
+                if (x[a + 1].size() == 0) x.erase(a + 1);
+            }
+            _size -= n;
+            if (x.size() > 1 && x[a].size() == 0) x.erase(a);
+            else if (a + 1 < x.size() && should_merge(x[a].size() + x[a + 1].size())) merge_chunk(a);
+            gc_step();
+            return pos;
+        }
+
+        template<class ForwardIt>
+        int insert_range(int pos, ForwardIt first, ForwardIt last, std::forward_iterator_tag) {
+            auto fill = [&](T *slot) {
+                ::new((void *) slot) T(*first);
+                ++first;
+            };
+            return insert_n(pos, int(std::distance(first, last)), fill);
+        }
+
+        // a single pass range is buffered first, its length is needed up front
+        template<class InputIt>
+        int insert_range(int pos, InputIt first, InputIt last, std::input_iterator_tag) {
+            std::vector<T> buffer(first, last);
+            return insert_range(pos, std::make_move_iterator(buffer.begin()), std::make_move_iterator(buffer.end()),
+                                std::forward_iterator_tag());
+        }
+
     public:
         typedef base_iterator<T, deque> iterator;
         typedef base_iterator<const T, const deque> const_iterator;
@@ -411,11 +750,42 @@ namespace sjtu {
         /**
          * Constructors
          */
-        deque() {
+        deque() : version(1) {
             _size = 0;
             init();
         }
 
+        /**
+         * builds the deque from [first, last), or from count copies of value, in chunks of about
+         * sqrt(2 * size) laid out directly; the index is then built in one linear pass by the first lookup.
+         */
+        template<class InputIt, class = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+        deque(InputIt first, InputIt last) : version(1) {
+            _size = 0;
+            init();
+            insert_range(0, first, last, typename std::iterator_traits<InputIt>::iterator_category());
+        }
+
+        deque(size_t count, const T &value) : version(1) {
+            _size = 0;
+            init();
+            auto fill = [&](T *slot) { ::new((void *) slot) T(value); };
+            insert_n(0, int(count), fill);
+        }
+
+        deque(const deque &other) : _size(other._size), x(other.x), gc_cursor(other.gc_cursor), version(1),
+                                    map_cache(other.map_cache) {}
+
+        deque &operator=(const deque &other) {
+            if (this == &other) return *this;
+            _size = other._size;
+            x = other.x;
+            gc_cursor = other.gc_cursor;
+            map_cache = other.map_cache;
+            ++version;
+            return *this;
+        }
+
         /**
          * Deconstructor
          */
@@ -437,13 +807,19 @@ namespace sjtu {
          * access the first element
          * throw container_is_empty when the container is empty.
          */
-        const T &front() const { return access(0); }
+        const T &front() const {
+            throw_if_empty();
+            return access(0);
+        }
 
         /**
          * access the last element
          * throw container_is_empty when the container is empty.
          */
-        const T &back() const { return access(size() - 1); }
+        const T &back() const {
+            throw_if_empty();
+            return access(size() - 1);
+        }
 
         /**
          * returns an iterator to the beginning.
@@ -469,12 +845,37 @@ namespace sjtu {
          */
         size_t size() const { return _size; }
 
+        // the number of chunks, to check their layout from outside
+        size_t chunk_count() const { return x.size(); }
+
         /**
          * clears the contents
          */
         void clear() {
             x.clear();
             init();
+            map_cache.invalidate(0);
+            ++version;
+        }
+
+        /**
+         * replaces the contents with [first, last), laid out like deque(first, last)
+         */
+        template<class InputIt, class = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+        void assign(InputIt first, InputIt last) {
+            clear();
+            insert_range(0, first, last, typename std::iterator_traits<InputIt>::iterator_category());
+        }
+
+        /**
+         * replaces the contents with count copies of value
+         */
+        void assign(size_t count, const T &value) {
+            // value may be an element of this deque
+            T copy(value);
+            clear();
+            auto fill = [&](T *slot) { ::new((void *) slot) T(copy); };
+            insert_n(0, int(count), fill);
         }
 
         /**
@@ -483,9 +884,44 @@ namespace sjtu {
          * returns an iterator pointing to the inserted value
          *     throw if the iterator is invalid or it point to a wrong place.
          */
-        iterator insert(iterator pos, const T &value) {
+        iterator insert(iterator pos, const T &value) { return emplace(pos, value); }
+
+        iterator insert(iterator pos, T &&value) { return emplace(pos, std::move(value)); }
+
+        /**
+         * constructs an element from args in place before pos.
+         * returns an iterator pointing to the new element
+         *     throw if the iterator is invalid or it point to a wrong place.
+         */
+        template<class... Args>
+        iterator emplace(iterator pos, Args &&... args) {
             pos.check_owns(this);
-            return iterator(this, insert_at(pos.pos, value));
+            return iterator(this, emplace_at(pos.pos, std::forward<Args>(args)...));
+        }
+
+        /**
+         * inserts count copies of value before pos.
+         * returns an iterator pointing to the first inserted value (pos itself when count is 0)
+         *     throw if the iterator is invalid or it point to a wrong place.
+         */
+        iterator insert(iterator pos, size_t count, const T &value) {
+            pos.check_owns(this);
+            // value may be an element of this deque, which the insertion moves
+            T copy(value);
+            auto fill = [&](T *slot) { ::new((void *) slot) T(copy); };
+            return iterator(this, insert_n(pos.pos, int(count), fill));
+        }
+
+        /**
+         * inserts the elements of [first, last) before pos.
+         * returns an iterator pointing to the first inserted value (pos itself when the range is empty)
+         *     throw if the iterator is invalid or it point to a wrong place.
+         */
+        template<class InputIt, class = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+        iterator insert(iterator pos, InputIt first, InputIt last) {
+            pos.check_owns(this);
+            return iterator(this, insert_range(pos.pos, first, last,
+                                               typename std::iterator_traits<InputIt>::iterator_category()));
         }
 
         /**
@@ -499,27 +935,63 @@ namespace sjtu {
             return iterator(this, remove_at(pos.pos));
         }
 
+        /**
+         * removes the elements in [first, last).
+         * returns an iterator pointing to the element that followed the removed range.
+         *     throw if an iterator is invalid, points to a wrong place or first comes after last.
+         */
+        iterator erase(iterator first, iterator last) {
+            first.check_owns(this);
+            last.check_owns(this);
+            throw_if_out_of_bound(first.pos, true);
+            throw_if_out_of_bound(last.pos, true);
+            if (first.pos > last.pos) throw invalid_iterator();
+            return iterator(this, remove_n(first.pos, last.pos - first.pos));
+        }
+
         /**
          * adds an element to the end
          */
-        void push_back(const T &value) { insert_at(size(), value); }
+        void push_back(const T &value) { emplace_at(size(), value); }
+
+        void push_back(T &&value) { emplace_at(size(), std::move(value)); }
+
+        /**
+         * constructs an element from args in place at the end
+         */
+        template<class... Args>
+        void emplace_back(Args &&... args) { emplace_at(size(), std::forward<Args>(args)...); }
 
         /**
          * removes the last element
          *     throw when the container is empty.
          */
-        void pop_back() { remove_at(size() - 1); }
+        void pop_back() {
+            throw_if_empty();
+            remove_at(size() - 1);
+        }
 
         /**
          * inserts an element to the beginning.
          */
-        void push_front(const T &value) { insert_at(0, value); }
+        void push_front(const T &value) { emplace_at(0, value); }
+
+        void push_front(T &&value) { emplace_at(0, std::move(value)); }
+
+        /**
+         * constructs an element from args in place at the beginning
+         */
+        template<class... Args>
+        void emplace_front(Args &&... args) { emplace_at(0, std::forward<Args>(args)...); }
 
         /**
          * removes the first element.
          *     throw when the container is empty.
          */
-        void pop_front() { remove_at(0); }
+        void pop_front() {
+            throw_if_empty();
+            remove_at(0);
+        }
 
         void debug() const {
             std::cerr << _size << "(" << x.size() << "): ";
@@ -7,6 +7,13 @@
 #include <list>
 #include <vector>
 #include <iostream>
+#include <memory>
+#include <utility>
+
+// every buffer and node is allocated through this, define it before including to hook allocations
+#ifndef SJTU_DEQUE_ALLOCATOR
+#define SJTU_DEQUE_ALLOCATOR std::allocator
+#endif
 
 namespace sjtu {
     template<class T>
@@ -21,6 +28,10 @@ namespace sjtu {
             Node(Node *prev = NULL, Node *next = NULL) : prev(prev), next(next) {}
 
             virtual ~Node() {}
+
+            static void *operator new(size_t n) { return SJTU_DEQUE_ALLOCATOR<char>().allocate(n); }
+
+            static void operator delete(void *p, size_t n) { SJTU_DEQUE_ALLOCATOR<char>().deallocate((char *) p, n); }
         } *head, *tail;
 
         struct Chunk {
@@ -30,11 +41,16 @@ namespace sjtu {
 
             Chunk(Node *head, Node *tail, int chunk_size = 0, Chunk *prev = NULL, Chunk *next = NULL) :
                     head(head), tail(tail), chunk_size(chunk_size), prev(prev), next(next) {}
+
+            static void *operator new(size_t n) { return SJTU_DEQUE_ALLOCATOR<char>().allocate(n); }
+
+            static void operator delete(void *p, size_t n) { SJTU_DEQUE_ALLOCATOR<char>().deallocate((char *) p, n); }
         } *chunk_head, *chunk_tail;
 
         struct Wrapper : public Node {
             T x;
-            Wrapper(const T &x, Node *prev = NULL, Node *next = NULL) : Node(prev, next), x(x) {}
+            template<class... Args>
+            Wrapper(Node *prev, Node *next, Args &&... args) : Node(prev, next), x(std::forward<Args>(args)...) {}
         };
 
         bool empty_chunk() const { return chunk_head->next == chunk_tail; }
@@ -294,8 +310,9 @@ namespace sjtu {
             } else return chunk;
         }
 
-        iterator _insert_before(Chunk *chunk, Node *pos, const T &x) {
-            Node *tmp = new Wrapper(x, pos->prev, pos);
+        template<class... Args>
+        iterator _insert_before(Chunk *chunk, Node *pos, Args &&... args) {
+            Node *tmp = new Wrapper(pos->prev, pos, std::forward<Args>(args)...);
             pos->prev->next = tmp;
             pos->prev = tmp;
             if (empty_chunk()) {
@@ -452,9 +469,19 @@ namespace sjtu {
          * returns an iterator pointing to the inserted value
          *     throw if the iterator is invalid or it point to a wrong place.
          */
-        iterator insert(iterator pos, const T &value) {
+        iterator insert(iterator pos, const T &value) { return emplace(pos, value); }
+
+        iterator insert(iterator pos, T &&value) { return emplace(pos, std::move(value)); }
+
+        /**
+         * constructs an element from args in place before pos.
+         * returns an iterator pointing to the new element
+         *     throw if the iterator is invalid or it point to a wrong place.
+         */
+        template<class... Args>
+        iterator emplace(iterator pos, Args &&... args) {
             if (pos.q != this) throw invalid_iterator();
-            return _insert_before(pos.chunk, pos.node, value);
+            return _insert_before(pos.chunk, pos.node, std::forward<Args>(args)...);
         }
 
         /**
@@ -476,6 +503,18 @@ namespace sjtu {
             _insert_before(chunk_tail, tail, value);
         }
 
+        void push_back(T &&value) {
+            _insert_before(chunk_tail, tail, std::move(value));
+        }
+
+        /**
+         * constructs an element from args in place at the end
+         */
+        template<class... Args>
+        void emplace_back(Args &&... args) {
+            _insert_before(chunk_tail, tail, std::forward<Args>(args)...);
+        }
+
         /**
          * removes the last element
          *     throw when the container is empty.
@@ -492,6 +531,18 @@ namespace sjtu {
             _insert_before(chunk_head->next, head->next, value);
         }
 
+        void push_front(T &&value) {
+            _insert_before(chunk_head->next, head->next, std::move(value));
+        }
+
+        /**
+         * constructs an element from args in place at the beginning
+         */
+        template<class... Args>
+        void emplace_front(Args &&... args) {
+            _insert_before(chunk_head->next, head->next, std::forward<Args>(args)...);
+        }
+
         /**
          * removes the first element.
          *     throw when the container is empty.
@@ -7,6 +7,12 @@
 #include <memory>
 #include <cstring>
 #include <cstdlib>
+#include <utility>
+
+// every buffer and node is allocated through this, define it before including to hook allocations
+#ifndef SJTU_DEQUE_ALLOCATOR
+#define SJTU_DEQUE_ALLOCATOR std::allocator
+#endif
 
 namespace sjtu {
 
@@ -17,7 +23,7 @@ namespace sjtu {
         T *ring_buffer;
         int _front, _rear, cap;
         int _size;
-        std::allocator<T> alloc;
+        SJTU_DEQUE_ALLOCATOR<T> alloc;
 
         int _real_pos(const int &pos) const {
             int pos_b = pos + _front;
@@ -110,7 +116,8 @@ namespace sjtu {
             }
         }
 
-        int insert_before(const int &pos, const T &x) {
+        template<class... Args>
+        int emplace_before(const int &pos, Args &&... args) {
             if (pos < 0 || pos > size()) throw index_out_of_bound();
             expand_if_full();
             int target = 0;
@@ -124,7 +131,7 @@ namespace sjtu {
                 _rear = _next_pos(_rear);
             }
             ++_size;
-            alloc.construct(ring_buffer + target, x);
+            alloc.construct(ring_buffer + target, std::forward<Args>(args)...);
             return pos;
         }
 
@@ -331,9 +338,19 @@ namespace sjtu {
          * returns an iterator pointing to the inserted value
          *     throw if the iterator is invalid or it point to a wrong place.
          */
-        iterator insert(const iterator &pos, const T &value) {
+        iterator insert(const iterator &pos, const T &value) { return emplace(pos, value); }
+
+        iterator insert(const iterator &pos, T &&value) { return emplace(pos, std::move(value)); }
+
+        /**
+         * constructs an element from args in place before pos.
+         * returns an iterator pointing to the new element
+         *     throw if the iterator is invalid or it point to a wrong place.
+         */
+        template<class... Args>
+        iterator emplace(const iterator &pos, Args &&... args) {
             pos.check_owns(this);
-            return iterator(this, insert_before(pos.pos, value));
+            return iterator(this, emplace_before(pos.pos, std::forward<Args>(args)...));
         }
 
         /**
@@ -350,9 +367,17 @@ namespace sjtu {
         /**
          * adds an element to the end
          */
-        void push_back(const T &value) {
+        void push_back(const T &value) { emplace_back(value); }
+
+        void push_back(T &&value) { emplace_back(std::move(value)); }
+
+        /**
+         * constructs an element from args in place at the end
+         */
+        template<class... Args>
+        void emplace_back(Args &&... args) {
             expand_if_full();
-            alloc.construct(ring_buffer + _rear, value);
+            alloc.construct(ring_buffer + _rear, std::forward<Args>(args)...);
             _rear = _next_pos(_rear);
             ++_size;
         }
@@ -371,10 +396,19 @@ namespace sjtu {
         /**
          * inserts an element to the beginning.
          */
-        void push_front(const T &value) {
+        void push_front(const T &value) { emplace_front(value); }
+
+        void push_front(T &&value) { emplace_front(std::move(value)); }
+
+        /**
+         * constructs an element from args in place at the beginning
+         */
+        template<class... Args>
+        void emplace_front(Args &&... args) {
             expand_if_full();
-            _front = _prev_pos(_front);
-            alloc.construct(ring_buffer + _front, value);
+            int slot = _prev_pos(_front);
+            alloc.construct(ring_buffer + slot, std::forward<Args>(args)...);
+            _front = slot;
             ++_size;
         }
 
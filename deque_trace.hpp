@@ -0,0 +1,331 @@
+#ifndef SJTU_DEQUE_TRACE_HPP
+#define SJTU_DEQUE_TRACE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * compact binary traces of deque operations.
+ *
+ * a trace is the 8-byte magic "DQTRACE1" followed by records of
+ *   opcode (1 byte), delay (LEB128, ns since the previous record), [position (LEB128)]
+ * only insert / erase / at carry a position. element values are not recorded,
+ * a replay pushes its own values.
+ */
+namespace bench {
+    enum trace_op {
+        TRACE_PUSH_BACK, TRACE_PUSH_FRONT, TRACE_POP_BACK, TRACE_POP_FRONT,
+        TRACE_INSERT, TRACE_ERASE, TRACE_AT, TRACE_FRONT, TRACE_BACK, TRACE_CLEAR,
+        TRACE_OP_COUNT
+    };
+
+    const char *const trace_op_names[TRACE_OP_COUNT] = {
+            "push_back", "push_front", "pop_back", "pop_front",
+            "insert", "erase", "at", "front", "back", "clear"
+    };
+
+    inline bool trace_op_has_pos(int op) { return op == TRACE_INSERT || op == TRACE_ERASE || op == TRACE_AT; }
+
+    struct trace_record {
+        unsigned char op;
+        uint64_t delay_ns;
+        uint64_t pos;
+    };
+
+    const char trace_magic[8] = {'D', 'Q', 'T', 'R', 'A', 'C', 'E', '1'};
+
+    class trace_writer {
+        static const size_t flush_size = 1 << 16;
+        FILE *out;
+        std::vector<unsigned char> buf;
+        std::chrono::steady_clock::time_point last;
+        uint64_t _count;
+
+        void put_varint(uint64_t v) {
+            while (v >= 0x80) {
+                buf.push_back((unsigned char) (v | 0x80));
+                v >>= 7;
+            }
+            buf.push_back((unsigned char) v);
+        }
+
+    public:
+        // an unopened writer ignores every record
+        trace_writer() : out(NULL), _count(0) {}
+
+        explicit trace_writer(const char *path) : trace_writer() { open(path); }
+
+        trace_writer(const trace_writer &) = delete;
+
+        trace_writer &operator=(const trace_writer &) = delete;
+
+        ~trace_writer() { close(); }
+
+        bool open(const char *path) {
+            close();
+            out = fopen(path, "wb");
+            if (!out) return false;
+            buf.assign(trace_magic, trace_magic + sizeof trace_magic);
+            last = std::chrono::steady_clock::now();
+            _count = 0;
+            return true;
+        }
+
+        bool is_open() const { return out != NULL; }
+
+        uint64_t count() const { return _count; }
+
+        void record(trace_op op, uint64_t pos = 0) {
+            if (!out) return;
+            auto now = std::chrono::steady_clock::now();
+            buf.push_back((unsigned char) op);
+            put_varint(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count()));
+            if (trace_op_has_pos(op)) put_varint(pos);
+            last = now;
+            ++_count;
+            if (buf.size() >= flush_size) flush();
+        }
+
+        void flush() {
+            if (!out) return;
+            if (!buf.empty()) fwrite(buf.data(), 1, buf.size(), out);
+            buf.clear();
+            fflush(out);
+        }
+
+        void close() {
+            if (!out) return;
+            flush();
+            fclose(out);
+            out = NULL;
+        }
+    };
+
+    /**
+     * loads a whole trace, decode with next() before timing anything.
+     */
+    class trace_reader {
+        std::vector<unsigned char> data;
+        size_t at;
+        std::string _error;
+
+        bool get_varint(uint64_t &v) {
+            v = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                if (at >= data.size()) return false;
+                unsigned char b = data[at++];
+                v |= uint64_t(b & 0x7f) << shift;
+                if (!(b & 0x80)) return true;
+            }
+            return false;
+        }
+
+    public:
+        trace_reader() : at(0) {}
+
+        bool open(const char *path) {
+            data.clear();
+            at = 0;
+            FILE *in = fopen(path, "rb");
+            if (!in) {
+                _error = std::string("cannot open ") + path;
+                return false;
+            }
+            unsigned char chunk[1 << 16];
+            size_t n;
+            while ((n = fread(chunk, 1, sizeof chunk, in)) > 0) data.insert(data.end(), chunk, chunk + n);
+            fclose(in);
+            if (data.size() < sizeof trace_magic || memcmp(data.data(), trace_magic, sizeof trace_magic) != 0) {
+                _error = std::string(path) + " is not a deque trace";
+                return false;
+            }
+            at = sizeof trace_magic;
+            return true;
+        }
+
+        const std::string &error() const { return _error; }
+
+        // false at the end of the trace, or on a truncated / unknown record (then error() is set)
+        bool next(trace_record &r) {
+            if (at >= data.size()) return false;
+            r.op = data[at++];
+            r.pos = 0;
+            if (r.op >= TRACE_OP_COUNT) {
+                _error = "unknown opcode in trace";
+                return false;
+            }
+            if (!get_varint(r.delay_ns) || (trace_op_has_pos(r.op) && !get_varint(r.pos))) {
+                _error = "truncated trace";
+                return false;
+            }
+            return true;
+        }
+    };
+
+    /**
+     * a drop-in replacement for a deque Q of T that records every call made through it,
+     * e.g. recording_deque<T, sjtu::deque<T> >.
+     * Q is inherited privately, so a mutator without a recording overload here does not compile
+     * instead of going unrecorded. emplace_* are recorded as push / insert, and range insert / erase
+     * as one insert / erase per element, which replays to the same content.
+     * positions of iterator arguments are recorded as their distance to begin(),
+     * reads through iterators themselves are not recorded.
+     */
+    template<class T, class Q>
+    class recording_deque : private Q {
+        trace_writer *writer;
+
+        void record(trace_op op, uint64_t pos = 0) const {
+            if (writer) writer->record(op, pos);
+        }
+
+        // n elements inserted from pos on
+        void record_inserts(uint64_t pos, size_t n) const {
+            for (size_t i = 0; i < n; i++) record(TRACE_INSERT, pos + i);
+        }
+
+    public:
+        typedef typename Q::iterator iterator;
+        typedef typename Q::const_iterator const_iterator;
+
+        using Q::begin;
+        using Q::end;
+        using Q::cbegin;
+        using Q::cend;
+        using Q::size;
+        using Q::empty;
+
+        recording_deque() : Q(), writer(NULL) {}
+
+        explicit recording_deque(trace_writer *writer) : Q(), writer(writer) {}
+
+        void attach(trace_writer *w) { writer = w; }
+
+        void push_back(const T &value) {
+            record(TRACE_PUSH_BACK);
+            Q::push_back(value);
+        }
+
+        void push_back(T &&value) {
+            record(TRACE_PUSH_BACK);
+            Q::push_back(std::move(value));
+        }
+
+        template<class... Args>
+        void emplace_back(Args &&... args) {
+            record(TRACE_PUSH_BACK);
+            Q::emplace_back(std::forward<Args>(args)...);
+        }
+
+        void push_front(const T &value) {
+            record(TRACE_PUSH_FRONT);
+            Q::push_front(value);
+        }
+
+        void push_front(T &&value) {
+            record(TRACE_PUSH_FRONT);
+            Q::push_front(std::move(value));
+        }
+
+        template<class... Args>
+        void emplace_front(Args &&... args) {
+            record(TRACE_PUSH_FRONT);
+            Q::emplace_front(std::forward<Args>(args)...);
+        }
+
+        void pop_back() {
+            record(TRACE_POP_BACK);
+            Q::pop_back();
+        }
+
+        void pop_front() {
+            record(TRACE_POP_FRONT);
+            Q::pop_front();
+        }
+
+        iterator insert(iterator pos, const T &value) {
+            record(TRACE_INSERT, uint64_t(pos - Q::begin()));
+            return Q::insert(pos, value);
+        }
+
+        iterator insert(iterator pos, T &&value) {
+            record(TRACE_INSERT, uint64_t(pos - Q::begin()));
+            return Q::insert(pos, std::move(value));
+        }
+
+        template<class... Args>
+        iterator emplace(iterator pos, Args &&... args) {
+            record(TRACE_INSERT, uint64_t(pos - Q::begin()));
+            return Q::emplace(pos, std::forward<Args>(args)...);
+        }
+
+        iterator insert(iterator pos, size_t count, const T &value) {
+            record_inserts(uint64_t(pos - Q::begin()), count);
+            return Q::insert(pos, count, value);
+        }
+
+        // an input range is only counted once it is consumed, so it is recorded after the insert
+        template<class InputIt, class = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+        iterator insert(iterator pos, InputIt first, InputIt last) {
+            uint64_t at = uint64_t(pos - Q::begin());
+            size_t before = Q::size();
+            iterator it = Q::insert(pos, first, last);
+            record_inserts(at, Q::size() - before);
+            return it;
+        }
+
+        iterator erase(iterator pos) {
+            record(TRACE_ERASE, uint64_t(pos - Q::begin()));
+            return Q::erase(pos);
+        }
+
+        iterator erase(iterator first, iterator last) {
+            uint64_t at = uint64_t(first - Q::begin());
+            for (int i = int(last - first); i > 0; i--) record(TRACE_ERASE, at);
+            return Q::erase(first, last);
+        }
+
+        T &at(size_t pos) {
+            record(TRACE_AT, pos);
+            return Q::at(pos);
+        }
+
+        const T &at(size_t pos) const {
+            record(TRACE_AT, pos);
+            return Q::at(pos);
+        }
+
+        T &operator[](size_t pos) {
+            record(TRACE_AT, pos);
+            return Q::operator[](pos);
+        }
+
+        const T &operator[](size_t pos) const {
+            record(TRACE_AT, pos);
+            return Q::operator[](pos);
+        }
+
+        const T &front() const {
+            record(TRACE_FRONT);
+            return Q::front();
+        }
+
+        const T &back() const {
+            record(TRACE_BACK);
+            return Q::back();
+        }
+
+        void clear() {
+            record(TRACE_CLEAR);
+            Q::clear();
+        }
+    };
+}
+
+#endif
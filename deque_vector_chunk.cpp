@@ -2,10 +2,19 @@
 #define SJTU_DEQUE_HPP
 
 #include "exceptions.hpp"
+#include "relocation.hpp"
 
 #include <cstddef>
 #include <cstring>
 #include <cstdlib>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// every buffer and node is allocated through this, define it before including to hook allocations
+#ifndef SJTU_DEQUE_ALLOCATOR
+#define SJTU_DEQUE_ALLOCATOR std::allocator
+#endif
 
 namespace sjtu
 {
@@ -16,135 +25,171 @@ class deque
   private:
     friend class iterator;
 
-    static const unsigned chunk_size = 512; // cannot be 1 otherwise there'd be something wrong with iterator
-    struct Chunk
-    {
-        T *data;
-        Chunk *prev;
-        Chunk *next;
-        std::allocator<T> allocator;
+    static const unsigned chunk_size = 512;
+    // chunk pointers a new map has room for
+    static const int initial_map_size = 8;
 
-        /* TODO: write our own allocator */
-        Chunk(Chunk *prev = NULL, Chunk *next = NULL) : prev(prev),
-                                                        next(next)
-        {
-            data = allocator.allocate(chunk_size);
-        }
+    SJTU_DEQUE_ALLOCATOR<T> allocator;
+    SJTU_DEQUE_ALLOCATOR<T *> map_allocator;
 
-        Chunk(const Chunk &other) = delete;
-
-        static Chunk *construct_from(const Chunk &other, int data_begin, int data_end)
-        {
-            Chunk *chunk = new Chunk;
-            for (int i = data_begin; i < data_end; i++)
-                chunk->allocator.construct(chunk->data + i, other.data[i]);
-            return chunk;
-        }
+    /**
+     * the chunks in use, the same shape as libstdc++'s deque map: map holds map_size chunk pointers,
+     * the chunks from head to tail are in use and the slots around them are room to grow, so the
+     * chunk of an element is found by index arithmetic. chunk_head is the first element in *head,
+     * chunk_tail one past the last one in *tail.
+     */
+    T **map;
+    int map_size;
+    T **head, **tail;
 
-        void destruct_range(int data_begin, int data_end)
-        {
-            for (int i = data_begin; i < data_end; i++)
-                allocator.destroy(data + i);
-        }
+    T *chunk_head, *chunk_tail;
 
-        ~Chunk() { allocator.deallocate(data, chunk_size); }
-    } * head, *tail;
+    T *new_chunk() { return allocator.allocate(chunk_size); }
 
-    T *chunk_head, *chunk_tail;
+    void delete_chunk(T *chunk) { allocator.deallocate(chunk, chunk_size); }
 
     void destruct()
     {
-        Chunk *ptr = head;
-        while (ptr->prev)
-            ptr = ptr->prev;
-        bool is_in_range = false;
-        while (ptr)
-        {
-            Chunk *tmp = ptr->next;
-            int data_begin = 0;
-            int data_end = chunk_size;
-            if (ptr == head)
-            {
-                data_begin = chunk_head - head->data;
-                is_in_range = true;
-            }
-            if (ptr == tail)
-                data_end = chunk_tail - tail->data;
-            if (is_in_range)
-                ptr->destruct_range(data_begin, data_end);
-            if (ptr == tail)
-                is_in_range = false;
-            delete ptr;
-            ptr = tmp;
+        for (T **node = head; node <= tail; node++)
+        {
+            T *data_begin = node == head ? chunk_head : *node;
+            T *data_end = node == tail ? chunk_tail : *node + chunk_size;
+            for (T *p = data_begin; p < data_end; p++)
+                allocator.destroy(p);
+            delete_chunk(*node);
         }
+        map_allocator.deallocate(map, map_size);
     }
 
     void copy_from(const deque &other)
     {
-        Chunk *ptr = other.head;
-        Chunk *prev = NULL;
-        while (ptr)
-        {
-            int data_begin = 0;
-            int data_end = chunk_size;
-            if (ptr == other.head)
-                data_begin = other.chunk_head - other.head->data;
-            if (ptr == other.tail)
-                data_end = other.chunk_tail - other.tail->data;
-            Chunk *cur = Chunk::construct_from(*ptr, data_begin, data_end);
-            cur->prev = prev;
-            if (prev)
-                prev->next = cur;
-            else
-                this->head = cur;
-            prev = cur;
-            ptr = ptr->next;
+        map_size = other.map_size;
+        map = map_allocator.allocate(map_size);
+        head = map + (other.head - other.map);
+        tail = map + (other.tail - other.map);
+        for (T **node = head, **that = other.head; node <= tail; node++, that++)
+        {
+            *node = new_chunk();
+            int data_begin = node == head ? other.chunk_head - *that : 0;
+            int data_end = node == tail ? other.chunk_tail - *that : chunk_size;
+            for (int i = data_begin; i < data_end; i++)
+                allocator.construct(*node + i, (*that)[i]);
         }
-        this->tail = prev;
-        this->chunk_head = this->head->data + (other.chunk_head - other.head->data);
-        this->chunk_tail = this->tail->data + (other.chunk_tail - other.tail->data);
+        chunk_head = *head + (other.chunk_head - *other.head);
+        chunk_tail = *tail + (other.chunk_tail - *other.tail);
     }
 
     void create_new()
     {
-        tail = head = new Chunk;
-        chunk_head = chunk_tail = head->data;
+        map_size = initial_map_size;
+        map = map_allocator.allocate(map_size);
+        head = tail = map + map_size / 2;
+        *head = new_chunk();
+        chunk_head = chunk_tail = *head;
+    }
+
+    /**
+     * moves the chunks in use to the middle of the map, doubling it first when they fill more
+     * than half of it, so either end has at least a quarter of the map to grow into.
+     */
+    void recenter()
+    {
+        int used = tail - head + 1;
+        int new_size = used * 2 > map_size ? map_size * 2 : map_size;
+        T **new_map = new_size == map_size ? map : map_allocator.allocate(new_size);
+        T **new_head = new_map + (new_size - used) / 2;
+        memmove(new_head, head, sizeof(T *) * used);
+        if (new_map != map)
+        {
+            map_allocator.deallocate(map, map_size);
+            map = new_map;
+            map_size = new_size;
+        }
+        head = new_head;
+        tail = new_head + used - 1;
     }
 
     void append_chunk()
     {
-        if (!tail->next)
-            tail->next = new Chunk(tail);
-        tail = tail->next;
+        if (tail + 1 == map + map_size)
+            recenter();
+        *++tail = new_chunk();
     }
 
     void prepend_chunk()
     {
-        if (!head->prev)
-            head->prev = new Chunk(NULL, head);
-        head = head->prev;
+        if (head == map)
+            recenter();
+        *--head = new_chunk();
     }
 
-    void shrink_tail_chunk()
+    void shrink_tail_chunk() { delete_chunk(*tail--); }
+
+    void shrink_head_chunk() { delete_chunk(*head++); }
+
+    void throw_when_empty() const
     {
-        Chunk *tmp = tail->prev;
-        delete tail;
-        tail = tmp;
-        tail->next = NULL;
+        if (this->empty())
+            throw container_is_empty();
     }
 
-    void shrink_head_chunk()
+    // index of the element at pos in the chunk of node, size() for end()
+    int index_of(T *const *node, const T *pos) const
     {
-        Chunk *tmp = head->next;
-        delete head;
-        head = tmp;
-        head->prev = NULL;
+        return (node - head) * chunk_size + (pos - *node) - (chunk_head - *head);
     }
 
-    void throw_when_empty() const
+    /**
+     * the chunk and slot of element index, end() for size().
+     * a full tail chunk has end() one past its last slot rather than at the start of the next chunk.
+     */
+    void locate(int index, T **&node, T *&pos) const
     {
-        if (this->empty())
-            throw container_is_empty();
+        if (index < 0 || index > int(size()))
+            throw index_out_of_bound();
+        int offset = index + (chunk_head - *head);
+        node = head + offset / chunk_size;
+        if (node > tail)
+        {
+            node = tail;
+            pos = *tail + chunk_size;
+        }
+        else
+            pos = *node + offset % chunk_size;
+    }
+
+    /**
+     * moves the elements after the raw slot gap, up to and including last, one slot towards the front,
+     * a chunk segment at a time. last's slot is raw afterwards.
+     */
+    void shift_to_front(T **gap_node, T *gap, T **last_node, T *last)
+    {
+        while (gap_node != last_node)
+        {
+            T *end = *gap_node + chunk_size;
+            relocate(gap, gap + 1, end - gap - 1);
+            ++gap_node;
+            relocate(end - 1, *gap_node, 1);
+            gap = *gap_node;
+        }
+        relocate(gap, gap + 1, last - gap);
+    }
+
+    /**
+     * moves the elements from first up to the raw slot gap one slot towards the back,
+     * a chunk segment at a time. first's slot is raw afterwards.
+     */
+    void shift_to_back(T **first_node, T *first, T **gap_node, T *gap)
+    {
+        while (gap_node != first_node)
+        {
+            relocate(*gap_node + 1, *gap_node, gap - *gap_node);
+            T *end = *gap_node;
+            --gap_node;
+            gap = *gap_node + chunk_size - 1;
+            relocate(end, gap, 1);
+        }
+        relocate(first + 1, first, gap - first);
     }
 
   public:
@@ -154,109 +199,25 @@ class deque
     {
       private:
         friend deque<T>;
+        friend class const_iterator;
 
         void debug(const char *msg) const
         {
-            fprintf(stderr, "%s: chunk %x at %d\n", msg, chunk, pos - chunk->data);
+            fprintf(stderr, "%s: chunk %d at %d\n", msg, int(node - q->head), int(pos - *node));
         }
 
-        bool is_at_the_end() const { return pos == chunk->data + chunk_size; }
-
-        int distance_to_head() const
-        {
-            Chunk *ptr = q->head;
-            int chunk_cnt = 0;
-            while (ptr != chunk)
-            {
-                ++chunk_cnt;
-                ptr = ptr->next;
-            }
-            int head_offset = q->chunk_head - q->head->data;
-            int tail_offset = pos - chunk->data;
-            return tail_offset + chunk_cnt * chunk_size - head_offset;
-        };
-
       protected:
         deque *q;
-        Chunk *chunk;
+        T **node;
         T *pos;
 
-        iterator(deque *q, Chunk *chunk, T *pos) : q(q), chunk(chunk), pos(pos) {}
-
-        void move_chunk(int i)
-        {
-            if (i == 0)
-                return;
-            int offset = pos - chunk->data;
-            while (i > 0)
-            {
-                --i;
-                if (!chunk->next)
-                {
-                    if (chunk == q->tail && offset == 0)
-                    {
-                        offset = chunk_size;
-                    }
-                    else
-                        throw index_out_of_bound();
-                }
-                else
-                    chunk = chunk->next;
-            }
-            while (i < 0)
-            {
-                ++i;
-                if (!chunk->prev)
-                {
-                    throw index_out_of_bound();
-                }
-                chunk = chunk->prev;
-            }
-            pos = chunk->data + offset;
-        }
-
-        void move_forward(int i)
-        {
-            if (i == 0)
-                return;
-            while (i < 0)
-            {
-                ++i;
-                if (pos == chunk->data)
-                {
-                    if (!chunk->prev)
-                        throw index_out_of_bound();
-                    chunk = chunk->prev;
-                    pos = chunk->data + chunk_size;
-                }
-                --pos;
-                if (chunk == q->head && pos < q->chunk_head)
-                    throw index_out_of_bound();
-            }
-            while (i > 0)
-            {
-                --i;
-                ++pos;
-                if (pos == chunk->data + chunk_size)
-                {
-                    if (chunk != q->tail)
-                    {
-                        if (!chunk->next)
-                            throw index_out_of_bound();
-                        chunk = chunk->next;
-                        pos = chunk->data;
-                    }
-                }
-                if (chunk == q->tail && pos > q->chunk_tail)
-                    throw index_out_of_bound();
-            }
-        }
+        iterator(deque *q, T **node, T *pos) : q(q), node(node), pos(pos) {}
 
       public:
         /** constructors **/
-        iterator() : q(NULL), chunk(NULL), pos(NULL) {}
+        iterator() : q(NULL), node(NULL), pos(NULL) {}
 
-        iterator(const iterator &other) : iterator(other.q, other.chunk, other.pos) {}
+        iterator(const iterator &other) = default;
 
         /**
              * return a new iterator which pointer n-next elements
@@ -266,27 +227,7 @@ class deque
         iterator operator+(const int &n) const
         {
             iterator that(*this);
-            if (n > 0)
-            {
-                if (n <= chunk_size)
-                    that.move_forward(n);
-                else
-                {
-                    that.move_forward(n % chunk_size);
-                    that.move_chunk(n / chunk_size);
-                }
-            }
-            else if (n < 0)
-            {
-                if (n >= -chunk_size)
-                    that.move_forward(n);
-                else
-                {
-                    that.move_forward(-(int)((-n) % chunk_size));
-                    that.move_chunk(-(int)((-n) / chunk_size));
-                }
-            }
-
+            q->locate(q->index_of(node, pos) + n, that.node, that.pos);
             return that;
         }
 
@@ -298,18 +239,18 @@ class deque
         {
             if (rhs.q != this->q)
                 throw invalid_iterator();
-            return this->distance_to_head() - rhs.distance_to_head();
+            return q->index_of(node, pos) - q->index_of(rhs.node, rhs.pos);
         }
 
         iterator operator+=(const int &n)
         {
-            this->move_forward(n);
+            *this = *this + n;
             return *this;
         }
 
         iterator operator-=(const int &n)
         {
-            this->move_forward(-n);
+            *this = *this - n;
             return *this;
         }
 
@@ -319,7 +260,7 @@ class deque
         iterator operator++(int)
         {
             iterator that(*this);
-            this->move_forward(1);
+            ++*this;
             return that;
         }
 
@@ -328,7 +269,10 @@ class deque
              */
         iterator &operator++()
         {
-            this->move_forward(1);
+            if (node == q->tail && pos == q->chunk_tail)
+                throw index_out_of_bound();
+            if (++pos == *node + chunk_size && node != q->tail)
+                pos = *++node;
             return *this;
         }
 
@@ -338,7 +282,7 @@ class deque
         iterator operator--(int)
         {
             iterator that(*this);
-            this->move_forward(-1);
+            --*this;
             return that;
         }
 
@@ -347,7 +291,11 @@ class deque
              */
         iterator &operator--()
         {
-            this->move_forward(-1);
+            if (node == q->head && pos == q->chunk_head)
+                throw index_out_of_bound();
+            if (pos == *node)
+                pos = *--node + chunk_size;
+            --pos;
             return *this;
         }
 
@@ -356,7 +304,7 @@ class deque
              */
         T &operator*() const
         {
-            if (chunk == q->tail && pos == q->chunk_tail)
+            if (node == q->tail && pos == q->chunk_tail)
                 throw index_out_of_bound();
             return *pos;
         }
@@ -371,12 +319,12 @@ class deque
              */
         bool operator==(const iterator &rhs) const
         {
-            return (q == rhs.q) && (chunk == rhs.chunk) && (pos == rhs.pos);
+            return (q == rhs.q) && (node == rhs.node) && (pos == rhs.pos);
         }
 
         bool operator==(const const_iterator &rhs) const
         {
-            return (q == rhs.q) && (chunk == rhs.chunk) && (pos == rhs.pos);
+            return (q == rhs.q) && (node == rhs.node) && (pos == rhs.pos);
         }
 
         /**
@@ -393,105 +341,21 @@ class deque
         //  and it should be able to construct from an iterator.
       private:
         friend deque<T>;
-
-        bool is_at_the_end() { return pos == chunk->data + chunk_size; }
-
-        int distance_to_head() const
-        {
-            Chunk *ptr = q->head;
-            int chunk_cnt = 0;
-            while (ptr != chunk)
-            {
-                ++chunk_cnt;
-                ptr = ptr->next;
-            }
-            int head_offset = q->chunk_head - q->head->data;
-            int tail_offset = pos - chunk->data;
-            return tail_offset + chunk_cnt * chunk_size - head_offset;
-        };
-
-        void move_chunk(int i)
-        {
-            if (i == 0)
-                return;
-            int offset = pos - chunk->data;
-            while (i > 0)
-            {
-                --i;
-                if (!chunk->next)
-                {
-                    if (chunk == q->tail && offset == 0)
-                    {
-                        offset = chunk_size;
-                    }
-                    else
-                        throw index_out_of_bound();
-                }
-                else
-                    chunk = chunk->next;
-            }
-            while (i < 0)
-            {
-                ++i;
-                if (!chunk->prev)
-                {
-                    throw index_out_of_bound();
-                }
-                chunk = chunk->prev;
-            }
-            pos = chunk->data + offset;
-        }
-
-        void move_forward(int i)
-        {
-            if (i == 0)
-                return;
-            while (i < 0)
-            {
-                ++i;
-                if (pos == chunk->data)
-                {
-                    if (!chunk->prev)
-                        throw index_out_of_bound();
-                    chunk = chunk->prev;
-                    pos = chunk->data + chunk_size;
-                }
-                --pos;
-                if (chunk == q->head && pos < q->chunk_head)
-                    throw index_out_of_bound();
-            }
-            while (i > 0)
-            {
-                --i;
-                ++pos;
-                if (pos == chunk->data + chunk_size)
-                {
-                    if (chunk != q->tail)
-                    {
-                        if (!chunk->next)
-                            throw index_out_of_bound();
-                        chunk = chunk->next;
-                        pos = chunk->data;
-                    }
-                }
-                if (chunk == q->tail && pos > q->chunk_tail)
-                    throw index_out_of_bound();
-            }
-        }
+        friend class iterator;
 
       protected:
         const deque *q;
-        const Chunk *chunk;
+        T *const *node;
         const T *pos;
 
-        const_iterator(const deque *q, const Chunk *chunk, const T *pos) : q(q), chunk(chunk), pos(pos) {}
+        const_iterator(const deque *q, T *const *node, const T *pos) : q(q), node(node), pos(pos) {}
 
       public:
-        const_iterator(const const_iterator &other) : const_iterator(other.q, other.chunk, other.pos) {}
+        const_iterator() : q(NULL), node(NULL), pos(NULL) {}
 
-        const_iterator(const iterator &other) : const_iterator(other.q, other.chunk.other.pos) {}
+        const_iterator(const const_iterator &other) = default;
 
-        const_iterator() {}
+        const_iterator(const iterator &other) : const_iterator(other.q, other.node, other.pos) {}
 
         /**
              * return a new iterator which pointer n-next elements
@@ -500,19 +364,10 @@ class deque
              */
         const_iterator operator+(const int &n) const
         {
-            const_iterator that(*this);
-            if (n > 0)
-            {
-                that.move_forward(n % chunk_size);
-                that.move_chunk(n / chunk_size);
-            }
-            else if (n < 0)
-            {
-                /* TODO: is chunk_size is 1, then move_forward is always called with 0, which may cause exception */
-                that.move_forward(-(int)((-n) % chunk_size));
-                that.move_chunk(-(int)((-n) / chunk_size));
-            }
-            return that;
+            T **to_node;
+            T *to_pos;
+            q->locate(q->index_of(node, pos) + n, to_node, to_pos);
+            return const_iterator(q, to_node, to_pos);
         }
 
         const_iterator operator-(const int &n) const { return this->operator+(-n); }
@@ -523,7 +378,7 @@ class deque
         {
             if (rhs.q != this->q)
                 throw invalid_iterator();
-            return this->distance_to_head() - rhs.distance_to_head();
+            return q->index_of(node, pos) - q->index_of(rhs.node, rhs.pos);
         }
 
         /**
@@ -531,7 +386,7 @@ class deque
              */
         const T &operator*() const
         {
-            if (chunk == q->tail && pos == q->chunk_tail)
+            if (node == q->tail && pos == q->chunk_tail)
                 throw index_out_of_bound();
             return *pos;
         }
@@ -543,12 +398,12 @@ class deque
 
         bool operator==(const iterator &rhs) const
         {
-            return (q == rhs.q) && (chunk == rhs.chunk) && (pos == rhs.pos);
+            return (q == rhs.q) && (node == rhs.node) && (pos == rhs.pos);
         }
 
         bool operator==(const const_iterator &rhs) const
         {
-            return (q == rhs.q) && (chunk == rhs.chunk) && (pos == rhs.pos);
+            return (q == rhs.q) && (node == rhs.node) && (pos == rhs.pos);
         }
 
         /**
@@ -560,13 +415,13 @@ class deque
 
         const_iterator operator+=(const int &n)
         {
-            this->move_forward(n);
+            *this = *this + n;
             return *this;
         }
 
         const_iterator operator-=(const int &n)
         {
-            this->move_forward(-n);
+            *this = *this - n;
             return *this;
         }
 
@@ -575,8 +430,8 @@ class deque
              */
         const_iterator operator++(int)
         {
-            iterator that(*this);
-            this->move_forward(1);
+            const_iterator that(*this);
+            ++*this;
             return that;
         }
 
@@ -585,7 +440,10 @@ class deque
              */
         const_iterator &operator++()
         {
-            this->move_forward(1);
+            if (node == q->tail && pos == q->chunk_tail)
+                throw index_out_of_bound();
+            if (++pos == *node + chunk_size && node != q->tail)
+                pos = *++node;
             return *this;
         }
 
@@ -594,8 +452,8 @@ class deque
              */
         const_iterator operator--(int)
         {
-            iterator that(*this);
-            this->move_forward(-1);
+            const_iterator that(*this);
+            --*this;
             return that;
         }
 
@@ -604,7 +462,11 @@ class deque
              */
         const_iterator &operator--()
         {
-            this->move_forward(-1);
+            if (node == q->head && pos == q->chunk_head)
+                throw index_out_of_bound();
+            if (pos == *node)
+                pos = *--node + chunk_size;
+            --pos;
             return *this;
         }
     };
@@ -637,9 +499,15 @@ class deque
          * access specified element with bounds checking
          * throw index_out_of_bound if out of bound.
          */
-    T &at(const size_t &pos) { return *(begin() + pos); }
+    T &at(const size_t &pos)
+    {
+        if (pos >= size())
+            throw index_out_of_bound();
+        int offset = int(pos) + (chunk_head - *head);
+        return head[offset / chunk_size][offset % chunk_size];
+    }
 
-    const T &at(const size_t &pos) const { return *(cbegin() + pos); }
+    const T &at(const size_t &pos) const { return const_cast<deque *>(this)->at(pos); }
 
     T &operator[](const size_t &pos) { return this->at(pos); }
 
@@ -693,7 +561,7 @@ class deque
     /**
          * returns the number of elements
          */
-    size_t size() const { return cend() - cbegin(); }
+    size_t size() const { return (tail - head) * chunk_size + (chunk_tail - *tail) - (chunk_head - *head); }
 
     /**
          * clears the contents
@@ -710,22 +578,47 @@ class deque
          * returns an iterator pointing to the inserted value
          *     throw if the iterator is invalid or it point to a wrong place.
          */
-    iterator insert(iterator pos, const T &value)
+    iterator insert(iterator pos, const T &value) { return emplace(pos, value); }
+
+    iterator insert(iterator pos, T &&value) { return emplace(pos, std::move(value)); }
+
+    /**
+         * constructs an element from args in place before pos.
+         * returns an iterator pointing to the new element
+         *     throw if the iterator is invalid or it point to a wrong place.
+         */
+    template <class... Args>
+    iterator emplace(iterator pos, Args &&... args)
     {
+        if (pos.q != this)
+            throw invalid_iterator();
         if (pos == end())
         {
-            push_back(value);
+            emplace_back(std::forward<Args>(args)...);
             return end() - 1;
         }
-        push_back(value);
-        iterator cur = end();
-        --cur;
-        while (cur != pos)
+        /**
+         * the new element is built at the end nearer to pos, which may move the map, and carried
+         * over the elements between that end and pos, which shift by one slot.
+         */
+        int index = pos - begin();
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type carried;
+        T *value = reinterpret_cast<T *>(&carried);
+        if (index < int(size()) - index)
+        {
+            emplace_front(std::forward<Args>(args)...);
+            locate(index, pos.node, pos.pos);
+            relocate(value, chunk_head, 1);
+            shift_to_front(head, chunk_head, pos.node, pos.pos);
+        }
+        else
         {
-            iterator next = cur;
-            --cur;
-            std::swap_ranges(next.pos, next.pos + 1, cur.pos);
+            emplace_back(std::forward<Args>(args)...);
+            locate(index, pos.node, pos.pos);
+            relocate(value, chunk_tail - 1, 1);
+            shift_to_back(pos.node, pos.pos, tail, chunk_tail - 1);
         }
+        relocate(pos.pos, value, 1);
         return pos;
     }
 
@@ -737,30 +630,52 @@ class deque
          */
     iterator erase(iterator pos)
     {
-        iterator lst = end();
-        --lst;
-        iterator cur = pos;
-        while (cur != lst)
+        if (pos.q != this)
+            throw invalid_iterator();
+        if (pos == end())
+            throw index_out_of_bound();
+        // the erased element is carried to the end nearer to it and popped there
+        int index = pos - begin();
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type carried;
+        T *value = reinterpret_cast<T *>(&carried);
+        relocate(value, pos.pos, 1);
+        if (index < int(size()) - 1 - index)
+        {
+            shift_to_back(head, chunk_head, pos.node, pos.pos);
+            relocate(chunk_head, value, 1);
+            pop_front();
+        }
+        else
         {
-            iterator prev = cur;
-            ++cur;
-            std::swap_ranges(prev.pos, prev.pos + 1, cur.pos);
+            shift_to_front(pos.node, pos.pos, tail, chunk_tail - 1);
+            relocate(chunk_tail - 1, value, 1);
+            pop_back();
         }
-        pop_back();
-        return pos;
+        // pos may sit in a chunk pop_front or pop_back just released
+        return begin() + index;
     }
 
     /**
          * adds an element to the end
          */
-    void push_back(const T &value)
+    void push_back(const T &value) { emplace_back(value); }
+
+    void push_back(T &&value) { emplace_back(std::move(value)); }
+
+    /**
+         * constructs an element from args in place at the end
+         */
+    template <class... Args>
+    void emplace_back(Args &&... args)
     {
-        if (chunk_tail - tail->data == chunk_size)
+        if (empty())
+            chunk_head = chunk_tail = *head;
+        if (chunk_tail - *tail == chunk_size)
         {
             append_chunk();
-            chunk_tail = tail->data;
+            chunk_tail = *tail;
         }
-        tail->allocator.construct(chunk_tail, value);
+        allocator.construct(chunk_tail, std::forward<Args>(args)...);
         ++chunk_tail;
     }
 
@@ -772,13 +687,13 @@ class deque
     {
         throw_when_empty();
         --chunk_tail;
-        tail->allocator.destroy(chunk_tail);
-        if (chunk_tail - tail->data == 0)
+        allocator.destroy(chunk_tail);
+        if (chunk_tail - *tail == 0)
         {
             if (head != tail)
             {
                 shrink_tail_chunk();
-                chunk_tail = tail->data + chunk_size;
+                chunk_tail = *tail + chunk_size;
             }
         }
     }
@@ -786,15 +701,26 @@ class deque
     /**
          * inserts an element to the beginning.
          */
-    void push_front(const T &value)
+    void push_front(const T &value) { emplace_front(value); }
+
+    void push_front(T &&value) { emplace_front(std::move(value)); }
+
+    /**
+         * constructs an element from args in place at the beginning
+         */
+    template <class... Args>
+    void emplace_front(Args &&... args)
     {
-        if (chunk_head - head->data == 0)
+        // an empty deque grows from the end of its only chunk, so the tail chunk never ends up empty
+        if (empty())
+            chunk_head = chunk_tail = *head + chunk_size;
+        if (chunk_head - *head == 0)
         {
             prepend_chunk();
-            chunk_head = head->data + chunk_size;
+            chunk_head = *head + chunk_size;
         }
+        allocator.construct(chunk_head - 1, std::forward<Args>(args)...);
         --chunk_head;
-        head->allocator.construct(chunk_head, value);
     }
 
     /**
@@ -804,30 +730,28 @@ class deque
     void pop_front()
     {
         throw_when_empty();
-        head->allocator.destroy(chunk_head);
+        allocator.destroy(chunk_head);
         ++chunk_head;
-        if (chunk_head - head->data == chunk_size)
+        if (chunk_head - *head == chunk_size)
         {
             if (head == tail)
             {
-                chunk_head = chunk_tail = head->data;
+                chunk_head = chunk_tail = *head;
             }
             else
             {
                 shrink_head_chunk();
-                chunk_head = head->data;
+                chunk_head = *head;
             }
         }
     }
 
     void debug()
     {
-        Chunk *ptr = head;
-        while (ptr)
+        for (T **node = head; node <= tail; node++)
         {
             for (int i = 0; i < chunk_size; i++)
-                fprintf(stderr, "%d ", ptr->data[i]);
-            ptr = ptr->next;
+                fprintf(stderr, "%d ", (*node)[i]);
         }
         fprintf(stderr, "\n");
     }
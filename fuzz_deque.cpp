@@ -0,0 +1,664 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <iterator>
+#include <type_traits>
+
+#include "bench_backends.hpp"
+
+/**
+ * differential fuzzer: runs long random operation sequences against every backend and
+ * std::deque side by side and stops at the first difference.
+ *
+ *   fuzz_deque [--backend name[,name...]] [--seed s] [--runs k] [--ops n] [--max-size n] [--check-every n]
+ *
+ * every run uses seed, seed + 1, ... and prints the failing seed and step, so
+ * `fuzz_deque --backend x --seed s --runs 1` reproduces a failure.
+ * operations: push / pop at both ends, insert / erase at iterators (checking the returned
+ * iterator), each insertion by copy, by move or by emplace, at / [] / front / back, writes
+ * through iterators, iterator arithmetic (+, -, +=, -=, ++, --, distance), copy construction
+ * and assignment, clear, and the exceptions thrown for empty containers, out of bound indexes
+ * and foreign iterators. backends that have them also get range insert / erase, construction
+ * from a range and assign(), and once before their runs a million element range insert, range erase,
+ * construction and assign(), whose contents and chunk count are checked.
+ * every --check-every operations (and at the end) the whole content is compared through
+ * iterators, const iterators and operator[]; after each run the element and heap
+ * counters must be back at zero.
+ *
+ * built with -DDEQUE_FUZZ_LIBFUZZER (clang++ -fsanitize=fuzzer,address) the same driver
+ * becomes a libFuzzer target which decodes the operations from the input bytes.
+ */
+
+namespace {
+    /**
+     * element that keeps track of how many copies are alive, to catch
+     * leaked or doubly destroyed elements. a moved-from value reads as moved_from,
+     * so a container handing out a moved-from element fails the comparison.
+     */
+    class value {
+        int x;
+    public:
+        static const int moved_from = -1000000;
+        static long long live;
+
+        explicit value(int x) : x(x) { ++live; }
+
+        value(const value &that) : x(that.x) { ++live; }
+
+        value(value &&that) noexcept : x(that.x) {
+            that.x = moved_from;
+            ++live;
+        }
+
+        value &operator=(const value &that) {
+            x = that.x;
+            return *this;
+        }
+
+        value &operator=(value &&that) noexcept {
+            x = that.x;
+            that.x = moved_from;
+            return *this;
+        }
+
+        ~value() { --live; }
+
+        int num() const { return x; }
+    };
+
+    long long value::live = 0;
+
+    // operations are drawn from a seeded generator ...
+    class random_source {
+        std::mt19937 rng;
+    public:
+        explicit random_source(unsigned seed) : rng(seed) {}
+
+        unsigned next(unsigned bound) { return bound ? unsigned(rng() % bound) : 0; }
+
+        bool exhausted() const { return false; }
+    };
+
+    // ... or decoded from a byte string
+    class byte_source {
+        const uint8_t *data;
+        size_t size, at;
+    public:
+        byte_source(const uint8_t *data, size_t size) : data(data), size(size), at(0) {}
+
+        unsigned next(unsigned bound) {
+            unsigned v = 0;
+            for (int i = 0; i < 2 && at < size; i++) v = v << 8 | data[at++];
+            return bound ? v % bound : 0;
+        }
+
+        bool exhausted() const { return at >= size; }
+    };
+
+    enum fuzz_op {
+        OP_PUSH_BACK, OP_PUSH_FRONT, OP_POP_BACK, OP_POP_FRONT, OP_INSERT, OP_ERASE, OP_READ, OP_WRITE,
+        OP_ITERATE, OP_ENDS, OP_COPY, OP_CLEAR, OP_RANGE_INSERT, OP_RANGE_ERASE, OP_THROW,
+        OP_COUNT
+    };
+
+    const char *const fuzz_op_names[OP_COUNT] = {
+            "push_back", "push_front", "pop_back", "pop_front", "insert", "erase", "read", "write",
+            "iterate", "front/back", "copy", "clear", "range insert", "range erase", "throw"
+    };
+
+    // relative frequencies, copy and clear are O(n) and kept rare
+    const unsigned fuzz_op_weight[OP_COUNT] = {16, 16, 10, 10, 12, 12, 8, 4, 8, 2, 1, 1, 2, 2, 2};
+
+    // backends with insert(pos, n, value), insert(pos, first, last) and erase(first, last)
+    template<class Q, class = void>
+    struct has_range_ops : std::false_type {};
+
+    template<class Q>
+    struct has_range_ops<Q, decltype((void) std::declval<Q &>().erase(std::declval<Q &>().begin(),
+                                                                       std::declval<Q &>().end()))>
+            : std::true_type {};
+
+    // backends with deque(first, last), deque(n, value) and assign()
+    template<class Q>
+    struct has_range_build : std::is_constructible<Q, typename Q::iterator, typename Q::iterator> {};
+
+    // a single pass view of a vector, to reach the input iterator path of a range insert
+    template<class It>
+    class single_pass {
+        It it;
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef typename std::iterator_traits<It>::value_type value_type;
+        typedef typename std::iterator_traits<It>::difference_type difference_type;
+        typedef typename std::iterator_traits<It>::pointer pointer;
+        typedef typename std::iterator_traits<It>::reference reference;
+
+        explicit single_pass(It it) : it(it) {}
+
+        reference operator*() const { return *it; }
+
+        single_pass &operator++() {
+            ++it;
+            return *this;
+        }
+
+        single_pass operator++(int) {
+            single_pass old = *this;
+            ++it;
+            return old;
+        }
+
+        bool operator==(const single_pass &rhs) const { return it == rhs.it; }
+
+        bool operator!=(const single_pass &rhs) const { return it != rhs.it; }
+    };
+
+    struct fuzz_config {
+        unsigned seed = 1;
+        int runs = 4;
+        long long ops = 200000;
+        int max_size = 6000;
+        int check_every = 1000;
+    };
+
+    template<class Q>
+    class differential {
+        Q q;
+        std::deque<int> ref;
+        const char *name;
+        long long step;
+        int last_op;
+        int next_value;
+        std::string failure;
+
+        bool fail(const std::string &what) {
+            if (failure.empty()) {
+                failure = what + " after " + fuzz_op_names[last_op] + " at step " + std::to_string(step) +
+                          ", size " + std::to_string(ref.size());
+            }
+            return false;
+        }
+
+        bool expect(bool cond, const char *what) { return cond || fail(what); }
+
+        template<class Source>
+        int pick_op(Source &src, bool grow) {
+            unsigned total = 0;
+            for (int i = 0; i < OP_COUNT; i++) total += fuzz_op_weight[i];
+            unsigned r = src.next(total);
+            int op = 0;
+            while (r >= fuzz_op_weight[op]) r -= fuzz_op_weight[op++];
+            // bias the size towards growing or shrinking, in long alternating stretches
+            if (!grow && (op == OP_PUSH_BACK || op == OP_PUSH_FRONT || op == OP_INSERT) && src.next(2)) op += 2;
+            if (grow && (op == OP_POP_BACK || op == OP_POP_FRONT || op == OP_ERASE) && src.next(2)) op -= 2;
+            if (op == OP_RANGE_INSERT || op == OP_RANGE_ERASE) {
+                op = grow == (src.next(4) != 0) ? OP_RANGE_INSERT : OP_RANGE_ERASE;
+            }
+            return op;
+        }
+
+        template<class D>
+        bool same_as_ref(D &d, const char *what) {
+            if (d.size() != ref.size()) return fail(std::string(what) + ": size " + std::to_string(d.size()));
+            if (d.empty() != ref.empty()) return fail(std::string(what) + ": empty()");
+            if (int(d.end() - d.begin()) != int(ref.size())) return fail(std::string(what) + ": end() - begin()");
+            size_t i = 0;
+            for (auto it = d.begin(); it != d.end(); ++it, ++i) {
+                if (i >= ref.size() || (*it).num() != ref[i]) return fail(std::string(what) + ": iterator walk");
+            }
+            if (i != ref.size()) return fail(std::string(what) + ": iterator walk length");
+            i = 0;
+            for (auto it = d.cbegin(); it != d.cend(); ++it, ++i) {
+                if (i >= ref.size() || it->num() != ref[i]) return fail(std::string(what) + ": const iterator walk");
+            }
+            for (i = 0; i < ref.size(); i++) {
+                if (d[i].num() != ref[i]) return fail(std::string(what) + ": operator[] at " + std::to_string(i));
+            }
+            return true;
+        }
+
+        template<class Source>
+        bool range_insert(Source &, std::false_type) { return true; }
+
+        template<class Source>
+        bool range_insert(Source &src, std::true_type) {
+            int n = int(ref.size());
+            int k = int(src.next(n + 1));
+            // mostly short ranges, now and then one long enough to go into fresh chunks
+            int count = int(src.next(src.next(8) ? 40 : 3000));
+            auto it = q.end();
+            int kind = int(src.next(3));
+            if (kind == 0) {
+                it = q.insert(q.begin() + k, size_t(count), value(next_value));
+                ref.insert(ref.begin() + k, count, next_value++);
+            } else {
+                std::vector<value> values;
+                for (int i = 0; i < count; i++) values.emplace_back(next_value + i);
+                if (kind == 1) {
+                    it = q.insert(q.begin() + k, values.begin(), values.end());
+                } else {
+                    it = q.insert(q.begin() + k, single_pass<std::vector<value>::iterator>(values.begin()),
+                                  single_pass<std::vector<value>::iterator>(values.end()));
+                }
+                for (int i = 0; i < count; i++) ref.insert(ref.begin() + k + i, next_value++);
+            }
+            if (!expect(it - q.begin() == k, "position of the iterator returned by range insert")) return false;
+            return expect(count == 0 || (*it).num() == ref[k], "value at the iterator returned by range insert");
+        }
+
+        template<class Source>
+        bool range_erase(Source &, std::false_type) { return true; }
+
+        template<class Source>
+        bool range_erase(Source &src, std::true_type) {
+            int n = int(ref.size());
+            int a = int(src.next(n + 1));
+            int b = a + int(src.next(src.next(4) ? std::min(n - a, 40) + 1 : n - a + 1));
+            auto it = q.erase(q.begin() + a, q.begin() + b);
+            ref.erase(ref.begin() + a, ref.begin() + b);
+            if (!expect(it - q.begin() == a, "position of the iterator returned by range erase")) return false;
+            return expect(a == int(ref.size()) || (*it).num() == ref[a], "value at the iterator returned by range erase");
+        }
+
+        bool range_build(std::false_type) { return true; }
+
+        // deque(first, last), deque(n, value) and assign() of the backends with range operations
+        bool range_build(std::true_type) {
+            std::vector<value> values;
+            for (int v : ref) values.emplace_back(v);
+            Q built(values.begin(), values.end());
+            if (!same_as_ref(built, "range constructor")) return false;
+            Q filled(size_t(3), value(-3));
+            if (!expect(filled.size() == 3 && filled[2].num() == -3, "count constructor")) return false;
+            filled.assign(size_t(5), value(-4));
+            if (!expect(filled.size() == 5 && filled[4].num() == -4, "assign of n copies")) return false;
+            filled.assign(values.begin(), values.end());
+            if (!same_as_ref(filled, "assign of a range")) return false;
+            q.assign(single_pass<std::vector<value>::iterator>(values.begin()),
+                     single_pass<std::vector<value>::iterator>(values.end()));
+            return same_as_ref(q, "assign of a single pass range");
+        }
+
+        template<class Source>
+        bool apply(int op, Source &src) {
+            int n = int(ref.size());
+            switch (op) {
+                case OP_PUSH_BACK: {
+                    value v(next_value);
+                    switch (src.next(3)) {
+                        case 0: q.push_back(v); break;
+                        case 1: q.push_back(std::move(v)); break;
+                        default: q.emplace_back(next_value);
+                    }
+                    ref.push_back(next_value++);
+                    return expect(q.back().num() == ref.back(), "back() after push_back");
+                }
+                case OP_PUSH_FRONT: {
+                    value v(next_value);
+                    switch (src.next(3)) {
+                        case 0: q.push_front(v); break;
+                        case 1: q.push_front(std::move(v)); break;
+                        default: q.emplace_front(next_value);
+                    }
+                    ref.push_front(next_value++);
+                    return expect(q.front().num() == ref.front(), "front() after push_front");
+                }
+                case OP_POP_BACK:
+                    if (n == 0) return true;
+                    q.pop_back();
+                    ref.pop_back();
+                    return expect(n == 1 || q.back().num() == ref.back(), "back() after pop_back");
+                case OP_POP_FRONT:
+                    if (n == 0) return true;
+                    q.pop_front();
+                    ref.pop_front();
+                    return expect(n == 1 || q.front().num() == ref.front(), "front() after pop_front");
+                case OP_INSERT: {
+                    int k = int(src.next(n + 1));
+                    value v(next_value);
+                    auto it = q.end();
+                    switch (src.next(3)) {
+                        case 0: it = q.insert(q.begin() + k, v); break;
+                        case 1: it = q.insert(q.begin() + k, std::move(v)); break;
+                        default: it = q.emplace(q.begin() + k, next_value);
+                    }
+                    ref.insert(ref.begin() + k, next_value++);
+                    if (!expect(it - q.begin() == k, "position of the iterator returned by insert")) return false;
+                    return expect((*it).num() == ref[k], "value at the iterator returned by insert");
+                }
+                case OP_ERASE: {
+                    if (n == 0) return true;
+                    int k = int(src.next(n));
+                    auto it = q.erase(q.begin() + k);
+                    ref.erase(ref.begin() + k);
+                    if (k == n - 1) return expect(it == q.end(), "erase of the last element returns end()");
+                    if (!expect(it - q.begin() == k, "position of the iterator returned by erase")) return false;
+                    return expect(it->num() == ref[k], "value at the iterator returned by erase");
+                }
+                case OP_READ: {
+                    if (n == 0) return true;
+                    int k = int(src.next(n));
+                    if (!expect(q.at(k).num() == ref[k], "at()")) return false;
+                    const Q &c = q;
+                    return expect(c[k].num() == ref[k], "const operator[]");
+                }
+                case OP_WRITE: {
+                    if (n == 0) return true;
+                    int k = int(src.next(n));
+                    auto it = q.begin() + k;
+                    *it = value(next_value);
+                    ref[k] = next_value++;
+                    return expect(q[k].num() == ref[k], "write through an iterator");
+                }
+                case OP_ITERATE: {
+                    if (n == 0) return expect(q.begin() == q.end(), "begin() == end() when empty");
+                    int a = int(src.next(n + 1)), b = int(src.next(n + 1));
+                    auto it = q.begin() + a;
+                    auto jt = q.end() - (n - b);
+                    if (!expect(jt - it == b - a, "distance of two iterators")) return false;
+                    if (a < b) {
+                        it += b - a;
+                    } else {
+                        it -= a - b;
+                    }
+                    if (!expect(it == jt, "+= / -= agree with + / -")) return false;
+                    if (b < n) {
+                        if (!expect((*it).num() == ref[b], "dereference after arithmetic")) return false;
+                        auto old = it++;
+                        if (!expect(old == jt && it - jt == 1, "post-increment")) return false;
+                        --it;
+                        if (!expect(it == jt, "pre-decrement")) return false;
+                    }
+                    if (b > 0) {
+                        auto old = it--;
+                        if (!expect(old == jt && (*it).num() == ref[b - 1], "post-decrement")) return false;
+                        ++it;
+                        if (!expect(it == jt, "pre-increment")) return false;
+                    }
+                    return true;
+                }
+                case OP_ENDS: {
+                    if (n == 0) return true;
+                    const Q &c = q;
+                    if (!expect(c.front().num() == ref.front() && c.back().num() == ref.back(), "front() / back()")) {
+                        return false;
+                    }
+                    return expect((*(q.end() - 1)).num() == ref.back(), "end() - 1");
+                }
+                case OP_COPY: {
+                    Q copy(q);
+                    if (!same_as_ref(copy, "copy constructor")) return false;
+                    copy.push_back(value(-1));
+                    if (!expect(q.size() == ref.size(), "copy shares state with the original")) return false;
+                    Q assigned;
+                    assigned.push_front(value(-2));
+                    assigned = q;
+                    assigned = assigned;
+                    if (!same_as_ref(assigned, "assignment")) return false;
+                    q = copy;
+                    ref.push_back(-1);
+                    if (!same_as_ref(q, "assignment from a copy")) return false;
+                    return range_build(has_range_build<Q>());
+                }
+                case OP_CLEAR:
+                    q.clear();
+                    ref.clear();
+                    return expect(q.empty() && q.size() == 0, "clear()");
+                case OP_RANGE_INSERT:
+                    return range_insert(src, has_range_ops<Q>());
+                case OP_RANGE_ERASE:
+                    return range_erase(src, has_range_ops<Q>());
+                default: {
+                    int kind = int(src.next(3));
+                    if (kind == 0) {
+                        try {
+                            q.at(n);
+                            return fail("at(size()) did not throw");
+                        } catch (sjtu::index_out_of_bound &) {}
+                    } else if (kind == 1 && n == 0) {
+                        try {
+                            q.pop_back();
+                            return fail("pop_back() of an empty deque did not throw");
+                        } catch (sjtu::container_is_empty &) {}
+                    } else {
+                        Q other;
+                        other.push_back(value(0));
+                        try {
+                            q.insert(other.begin(), value(0));
+                            return fail("insert at a foreign iterator did not throw");
+                        } catch (sjtu::invalid_iterator &) {}
+                    }
+                    return true;
+                }
+            }
+        }
+
+    public:
+        explicit differential(const char *name) : name(name), step(0), last_op(0), next_value(0) {}
+
+        const std::string &error() const { return failure; }
+
+        long long steps() const { return step; }
+
+        template<class Source>
+        bool run(Source &src, const fuzz_config &cfg) {
+            bool grow = true;
+            try {
+                for (step = 0; step < cfg.ops && !src.exhausted(); step++) {
+                    if (src.next(2000) == 0) grow = !grow;
+                    if (int(ref.size()) >= cfg.max_size) grow = false;
+                    last_op = pick_op(src, grow);
+                    if (!apply(last_op, src)) return false;
+                    if (!expect(q.size() == ref.size(), "size()")) return false;
+                    if (cfg.check_every > 0 && (step + 1) % cfg.check_every == 0 && !same_as_ref(q, "check")) {
+                        return false;
+                    }
+                }
+            } catch (sjtu::index_out_of_bound &) {
+                return fail("unexpected index_out_of_bound");
+            } catch (sjtu::container_is_empty &) {
+                return fail("unexpected container_is_empty");
+            } catch (sjtu::invalid_iterator &) {
+                return fail("unexpected invalid_iterator");
+            } catch (sjtu::exception &) {
+                return fail("unexpected sjtu::exception");
+            } catch (std::exception &e) {
+                return fail(std::string("unexpected exception ") + e.what());
+            }
+            return same_as_ref(q, "final check");
+        }
+    };
+
+    // runs one sequence against Q, then checks that every element and heap block was released
+    template<class Q, class Source>
+    bool fuzz_one(const char *name, Source &src, const fuzz_config &cfg, std::string &error, long long &steps) {
+        sjtu::chunk_pool_trim();
+        bench::allocations().reset();
+        value::live = 0;
+        {
+            differential<Q> d(name);
+            bool ok = d.run(src, cfg);
+            steps = d.steps();
+            if (!ok) {
+                error = d.error();
+                return false;
+            }
+        }
+        if (value::live != 0) {
+            error = std::to_string(value::live) + " elements alive after destruction";
+            return false;
+        }
+        // buffers parked in the chunk pools are not leaks
+        sjtu::chunk_pool_trim();
+        if (bench::allocations().live_bytes != 0) {
+            error = std::to_string(bench::allocations().live_bytes) + " heap bytes leaked";
+            return false;
+        }
+        return true;
+    }
+
+    // chunks of a deque built or grown in bulk stay within a small factor of sqrt(2 * size)
+    template<class Q>
+    bool chunked_evenly(const Q &q) {
+        return q.chunk_count() * 2 * std::sqrt(2.0 * q.size()) >= q.size();
+    }
+
+    template<class Q>
+    bool large_builds(std::string &, std::false_type) { return true; }
+
+    // construction and assign() with counts far beyond --max-size, see large_ranges
+    template<class Q>
+    bool large_builds(std::string &error, std::true_type) {
+        const int n = 1000000;
+        std::vector<int> values(n);
+        for (int i = 0; i < n; i++) values[i] = i;
+        Q built(values.begin(), values.end());
+        if (built.size() != size_t(n) || built[n / 2] != n / 2 || built[n - 1] != n - 1 || !chunked_evenly(built)) {
+            error = "range constructor of " + std::to_string(n) + " elements, " +
+                    std::to_string(built.chunk_count()) + " chunks";
+            return false;
+        }
+        Q filled(size_t(n), -1);
+        if (filled.size() != size_t(n) || filled[n - 1] != -1 || !chunked_evenly(filled)) {
+            error = "count constructor of " + std::to_string(n) + " elements, " +
+                    std::to_string(filled.chunk_count()) + " chunks";
+            return false;
+        }
+        filled.assign(values.begin(), values.end());
+        if (filled.size() != size_t(n) || filled[n - 1] != n - 1 || !chunked_evenly(filled)) {
+            error = "assign of " + std::to_string(n) + " elements, " + std::to_string(filled.chunk_count()) + " chunks";
+            return false;
+        }
+        return true;
+    }
+
+    template<class Q>
+    bool large_ranges(std::string &, std::false_type) { return true; }
+
+    /**
+     * range insert / erase, then construction, with counts far beyond --max-size, where the
+     * squared chunk sizes of the split check no longer fit in an int.
+     */
+    template<class Q>
+    bool large_ranges(std::string &error, std::true_type) {
+        const int n = 1000000, small = 1000;
+        Q q;
+        for (int i = 0; i < small; i++) q.push_back(i);
+        q.insert(q.begin() + small / 2, size_t(n), -1);
+        if (q.size() != size_t(n + small) || q[small / 2 - 1] != small / 2 - 1 || q[small / 2] != -1 ||
+            q[small / 2 + n - 1] != -1 || q[small / 2 + n] != small / 2 || q[n + small - 1] != small - 1) {
+            error = "contents after inserting " + std::to_string(n) + " elements";
+            return false;
+        }
+        if (!chunked_evenly(q)) {
+            error = std::to_string(n) + " inserted elements went into " + std::to_string(q.chunk_count()) + " chunks";
+            return false;
+        }
+        q.erase(q.begin() + small / 2, q.begin() + small / 2 + n);
+        for (int i = 0; i < small; i++) {
+            if (q[i] != i) {
+                error = "contents after erasing " + std::to_string(n) + " elements";
+                return false;
+            }
+        }
+        return large_builds<Q>(error, has_range_build<Q>());
+    }
+}
+
+#ifdef DEQUE_FUZZ_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    fuzz_config cfg;
+    cfg.ops = 1 << 20;
+    cfg.max_size = 2000;
+    cfg.check_every = 64;
+    bench::for_each_backend([&](auto b) {
+        using Q = typename decltype(b)::template deque<value>;
+        byte_source src(data, size);
+        std::string error;
+        long long steps;
+        if (!fuzz_one<Q>(b.name, src, cfg, error, steps)) {
+            fprintf(stderr, "%s: %s\n", b.name, error.c_str());
+            abort();
+        }
+    });
+    return 0;
+}
+
+#else
+
+static void usage() {
+    fprintf(stderr, "usage: fuzz_deque [--backend name[,name...]] [--seed s] [--runs k] [--ops n] [--max-size n]"
+                    " [--check-every n]\n");
+    fprintf(stderr, "backends:");
+    for (int i = 0; i < bench::backend_count; i++) fprintf(stderr, " %s", bench::backend_names[i]);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    fuzz_config cfg;
+    std::vector<std::string> backends;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--backend" && has_value) {
+            std::string names = argv[++i];
+            size_t from = 0;
+            while (from <= names.size()) {
+                size_t to = std::min(names.find(',', from), names.size());
+                if (to > from) backends.push_back(names.substr(from, to - from));
+                from = to + 1;
+            }
+        } else if (arg == "--seed" && has_value) cfg.seed = strtoul(argv[++i], NULL, 10);
+        else if (arg == "--runs" && has_value) cfg.runs = std::max(1, atoi(argv[++i]));
+        else if (arg == "--ops" && has_value) cfg.ops = std::max(1LL, atoll(argv[++i]));
+        else if (arg == "--max-size" && has_value) cfg.max_size = std::max(1, atoi(argv[++i]));
+        else if (arg == "--check-every" && has_value) cfg.check_every = atoi(argv[++i]);
+        else usage();
+    }
+
+    int failed = 0;
+    bench::for_each_backend([&](auto b) {
+        using Q = typename decltype(b)::template deque<value>;
+        if (!backends.empty() && std::find(backends.begin(), backends.end(), b.name) == backends.end()) return;
+        std::string large_error;
+        if (!large_ranges<typename decltype(b)::template deque<int> >(
+                large_error, has_range_ops<typename decltype(b)::template deque<int> >())) {
+            printf("%-22s FAILED (large ranges): %s\n", b.name, large_error.c_str());
+            ++failed;
+            return;
+        }
+        long long total = 0;
+        double seconds = 0;
+        for (int r = 0; r < cfg.runs; r++) {
+            unsigned seed = cfg.seed + r;
+            random_source src(seed);
+            std::string error;
+            long long steps = 0;
+            auto start = std::chrono::steady_clock::now();
+            bool ok = fuzz_one<Q>(b.name, src, cfg, error, steps);
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            total += steps;
+            if (!ok) {
+                printf("%-22s FAILED (seed %u): %s\n", b.name, seed, error.c_str());
+                ++failed;
+                return;
+            }
+        }
+        printf("%-22s ok, %d runs, %lld ops, %.0f ops/s\n", b.name, cfg.runs, total, total / seconds);
+    });
+    return failed ? 1 : 0;
+}
+
+#endif
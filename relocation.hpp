@@ -0,0 +1,68 @@
+#ifndef SJTU_RELOCATION_HPP
+#define SJTU_RELOCATION_HPP
+
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace sjtu {
+    template<class T, class = void>
+    struct has_relocatable_tag : std::false_type {};
+
+    template<class T>
+    struct has_relocatable_tag<T, typename std::conditional<true, void, typename T::trivially_relocatable>::type>
+            : T::trivially_relocatable {};
+
+    /**
+     * whether a T can be moved to other storage by copying its bytes, the old bytes then being
+     * released without running the destructor.
+     * holds for trivially copyable types and for types declaring
+     *   typedef std::true_type trivially_relocatable;
+     * other types can opt in by specializing it, as done for unique_ptr and shared_ptr below.
+     */
+    template<class T>
+    struct is_trivially_relocatable
+            : std::integral_constant<bool, std::is_trivially_copyable<T>::value || has_relocatable_tag<T>::value> {};
+
+    template<class U>
+    struct is_trivially_relocatable<std::unique_ptr<U> > : std::true_type {};
+
+    template<class U>
+    struct is_trivially_relocatable<std::shared_ptr<U> > : std::true_type {};
+
+    template<class T>
+    void relocate(T *dst, T *src, int n, std::true_type) {
+        if (n > 0 && dst != src) memmove((void *) dst, (const void *) src, sizeof(T) * n);
+    }
+
+    template<class T>
+    void relocate(T *dst, T *src, int n, std::false_type) {
+        if (dst == src) return;
+        if (dst < src) {
+            for (int i = 0; i < n; i++) {
+                ::new((void *) (dst + i)) T(std::move(src[i]));
+                src[i].~T();
+            }
+        } else {
+            for (int i = n - 1; i >= 0; i--) {
+                ::new((void *) (dst + i)) T(std::move(src[i]));
+                src[i].~T();
+            }
+        }
+    }
+
+    /**
+     * moves n live objects from src to dst, after which the objects at src are gone.
+     * the ranges may overlap, slots of dst outside src must be raw storage.
+     * trivially relocatable types are moved with one memmove, the others are
+     * move-constructed and destroyed one by one in an order that is safe for the overlap.
+     */
+    template<class T>
+    void relocate(T *dst, T *src, int n) {
+        relocate(dst, src, n, typename is_trivially_relocatable<T>::type());
+    }
+}
+
+#endif
@@ -0,0 +1,292 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <memory>
+
+#include "bench_backends.hpp"
+#include "bench_phases.hpp"
+#include "deque_trace.hpp"
+
+/**
+ * records and replays deque traces (see deque_trace.hpp).
+ *
+ *   trace_replay record-test7 <trace> [--seed s] [--scale f] [--no-bulk]
+ *       runs the test7 phases against std::deque through a recording_deque
+ *   trace_replay info <trace>
+ *   trace_replay check <trace>
+ *       records every mutator and accessor of recording_deque once into <trace> and checks
+ *       that each of them shows up in it, so no call goes unrecorded.
+ *   trace_replay replay <trace> [--backend name[,name...]] [--repeat k] [--paced]
+ *       replays the trace against every backend, timing each operation.
+ *       --paced waits for the recorded delay before each operation instead of
+ *       running them back to back.
+ *
+ * records that would be out of bound (e.g. an at() that threw in the traced program)
+ * are skipped and counted.
+ */
+
+typedef bench::recording_deque<bench::T, std::deque<bench::T> > test7_recorder_base;
+
+static bench::trace_writer *test7_writer;
+
+struct test7_recorder : test7_recorder_base {
+    test7_recorder() : test7_recorder_base(test7_writer) {}
+};
+
+struct replay_result {
+    double seconds;
+    uint64_t executed, skipped;
+    long long checksum;
+    bench::histogram latency[bench::TRACE_OP_COUNT];
+};
+
+static void usage() {
+    fprintf(stderr, "usage: trace_replay record-test7 <trace> [--seed s] [--scale f] [--no-bulk]\n");
+    fprintf(stderr, "       trace_replay info <trace>\n");
+    fprintf(stderr, "       trace_replay check <trace>\n");
+    fprintf(stderr, "       trace_replay replay <trace> [--backend name[,name...]] [--repeat k] [--paced]\n");
+    exit(1);
+}
+
+static bool load(const char *path, std::vector<bench::trace_record> &records) {
+    bench::trace_reader reader;
+    if (!reader.open(path)) {
+        fprintf(stderr, "%s\n", reader.error().c_str());
+        return false;
+    }
+    bench::trace_record r;
+    while (reader.next(r)) records.push_back(r);
+    if (!reader.error().empty()) {
+        fprintf(stderr, "%s after %zu records\n", reader.error().c_str(), records.size());
+        return false;
+    }
+    return true;
+}
+
+template<class Q>
+static void replay(const std::vector<bench::trace_record> &records, bool paced, replay_result &res) {
+    bench::op_clock clock;
+    Q q;
+    int value = 0;
+    long long sum = 0;
+    uint64_t executed = 0, skipped = 0;
+    auto begin = std::chrono::steady_clock::now();
+    auto due = begin;
+
+    for (const bench::trace_record &r : records) {
+        if (paced) {
+            due += std::chrono::nanoseconds(r.delay_ns);
+            while (std::chrono::steady_clock::now() < due);
+        }
+        size_t size = q.size();
+        bool needs_element = r.op != bench::TRACE_PUSH_BACK && r.op != bench::TRACE_PUSH_FRONT &&
+                             r.op != bench::TRACE_CLEAR;
+        if ((needs_element && size == 0) || (r.op == bench::TRACE_INSERT && r.pos > size) ||
+            ((r.op == bench::TRACE_ERASE || r.op == bench::TRACE_AT) && r.pos >= size)) {
+            ++skipped;
+            continue;
+        }
+        uint64_t start = clock.now();
+        switch (r.op) {
+            case bench::TRACE_PUSH_BACK:
+                q.push_back(bench::T(value++));
+                break;
+            case bench::TRACE_PUSH_FRONT:
+                q.push_front(bench::T(value++));
+                break;
+            case bench::TRACE_POP_BACK:
+                q.pop_back();
+                break;
+            case bench::TRACE_POP_FRONT:
+                q.pop_front();
+                break;
+            case bench::TRACE_INSERT:
+                q.insert(q.begin() + int(r.pos), bench::T(value++));
+                break;
+            case bench::TRACE_ERASE:
+                q.erase(q.begin() + int(r.pos));
+                break;
+            case bench::TRACE_AT:
+                sum += q.at(r.pos).num();
+                break;
+            case bench::TRACE_FRONT:
+                sum += q.front().num();
+                break;
+            case bench::TRACE_BACK:
+                sum += q.back().num();
+                break;
+            default:
+                q.clear();
+                break;
+        }
+        res.latency[r.op].record(clock.to_ns(clock.now() - start));
+        ++executed;
+    }
+
+    res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    res.executed = executed;
+    res.skipped = skipped;
+    res.checksum = sum;
+}
+
+static int record_test7(int argc, char **argv) {
+    if (argc < 3) usage();
+    bench::config cfg;
+    double scale = 1;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc) cfg.seed = strtoul(argv[++i], NULL, 10);
+        else if (arg == "--scale" && i + 1 < argc) scale = atof(argv[++i]);
+        else if (arg == "--no-bulk") cfg.good_complexity = false;
+        else usage();
+    }
+    if (scale <= 0) usage();
+    if (scale != 1) cfg.scale(scale);
+    bench::trace_writer writer;
+    if (!writer.open(argv[2])) {
+        fprintf(stderr, "cannot open %s\n", argv[2]);
+        return 1;
+    }
+    test7_writer = &writer;
+    bench::run_test7<test7_recorder>(cfg);
+    printf("recorded %llu operations to %s\n", (unsigned long long) writer.count(), argv[2]);
+    return 0;
+}
+
+static int info(int argc, char **argv) {
+    if (argc != 3) usage();
+    std::vector<bench::trace_record> records;
+    if (!load(argv[2], records)) return 1;
+    uint64_t count[bench::TRACE_OP_COUNT] = {}, total_ns = 0;
+    for (auto &r : records) {
+        ++count[r.op];
+        total_ns += r.delay_ns;
+    }
+    printf("%zu records spanning %.6f s\n", records.size(), total_ns / 1e9);
+    for (int op = 0; op < bench::TRACE_OP_COUNT; op++) {
+        if (count[op]) printf("%-12s %12llu\n", bench::trace_op_names[op], (unsigned long long) count[op]);
+    }
+    return 0;
+}
+
+static int check(int argc, char **argv) {
+    if (argc != 3) usage();
+    std::vector<unsigned char> expected;
+    {
+        bench::trace_writer writer;
+        if (!writer.open(argv[2])) {
+            fprintf(stderr, "cannot open %s\n", argv[2]);
+            return 1;
+        }
+        bench::recording_deque<int, std::deque<int> > q(&writer);
+        const bench::recording_deque<int, std::deque<int> > &c = q;
+        int one = 1, range[2] = {7, 8};
+        auto call = [&](bench::trace_op op, int times = 1) { expected.insert(expected.end(), times, op); };
+        q.push_back(one), call(bench::TRACE_PUSH_BACK);
+        q.push_back(2), call(bench::TRACE_PUSH_BACK);
+        q.emplace_back(3), call(bench::TRACE_PUSH_BACK);
+        q.push_front(one), call(bench::TRACE_PUSH_FRONT);
+        q.push_front(4), call(bench::TRACE_PUSH_FRONT);
+        q.emplace_front(5), call(bench::TRACE_PUSH_FRONT);
+        q.insert(q.begin() + 1, one), call(bench::TRACE_INSERT);
+        q.insert(q.begin() + 1, 6), call(bench::TRACE_INSERT);
+        q.emplace(q.begin() + 1, 6), call(bench::TRACE_INSERT);
+        q.insert(q.begin() + 2, size_t(3), 9), call(bench::TRACE_INSERT, 3);
+        q.insert(q.begin() + 2, range, range + 2), call(bench::TRACE_INSERT, 2);
+        q.erase(q.begin() + 1), call(bench::TRACE_ERASE);
+        q.erase(q.begin() + 1, q.begin() + 3), call(bench::TRACE_ERASE, 2);
+        q.at(0), call(bench::TRACE_AT);
+        c.at(0), call(bench::TRACE_AT);
+        q[0], call(bench::TRACE_AT);
+        c[0], call(bench::TRACE_AT);
+        q.front(), call(bench::TRACE_FRONT);
+        q.back(), call(bench::TRACE_BACK);
+        q.pop_back(), call(bench::TRACE_POP_BACK);
+        q.pop_front(), call(bench::TRACE_POP_FRONT);
+        q.clear(), call(bench::TRACE_CLEAR);
+        if (writer.count() != expected.size()) {
+            printf("FAILED: %zu calls, %llu records\n", expected.size(), (unsigned long long) writer.count());
+            return 1;
+        }
+    }
+    std::vector<bench::trace_record> records;
+    if (!load(argv[2], records)) return 1;
+    for (size_t i = 0; i < expected.size(); i++) {
+        if (i >= records.size() || records[i].op != expected[i]) {
+            printf("FAILED: record %zu is not %s\n", i, bench::trace_op_names[expected[i]]);
+            return 1;
+        }
+    }
+    printf("ok, %zu calls recorded\n", records.size());
+    return 0;
+}
+
+static int replay_all(int argc, char **argv) {
+    if (argc < 3) usage();
+    std::vector<std::string> backends;
+    int repeat = 1;
+    bool paced = false;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--backend" && i + 1 < argc) {
+            std::string names = argv[++i];
+            size_t from = 0;
+            while (from <= names.size()) {
+                size_t to = std::min(names.find(',', from), names.size());
+                if (to > from) backends.push_back(names.substr(from, to - from));
+                from = to + 1;
+            }
+        } else if (arg == "--repeat" && i + 1 < argc) repeat = std::max(1, atoi(argv[++i]));
+        else if (arg == "--paced") paced = true;
+        else usage();
+    }
+    std::vector<bench::trace_record> records;
+    if (!load(argv[2], records)) return 1;
+
+    long long reference = 0;
+    bool has_reference = false;
+    bench::for_each_backend([&](auto b) {
+        using Q = typename decltype(b)::template deque<bench::T>;
+        if (!backends.empty() && std::find(backends.begin(), backends.end(), b.name) == backends.end()) return;
+        std::unique_ptr<replay_result> best;
+        for (int k = 0; k < repeat; k++) {
+            std::unique_ptr<replay_result> res(new replay_result());
+            replay<Q>(records, paced, *res);
+            if (!best || res->seconds < best->seconds) best = std::move(res);
+        }
+        printf("\n%s: %.6f s, %llu ops, %.0f ops/s", b.name, best->seconds,
+               (unsigned long long) best->executed, best->executed / best->seconds);
+        if (best->skipped) printf(", %llu skipped", (unsigned long long) best->skipped);
+        printf("\n%-12s %12s %10s %10s %10s %12s\n", "op (ns)", "count", "p50", "p99", "p99.9", "max");
+        for (int op = 0; op < bench::TRACE_OP_COUNT; op++) {
+            const bench::histogram &h = best->latency[op];
+            if (h.count() == 0) continue;
+            printf("%-12s %12llu %10llu %10llu %10llu %12llu\n", bench::trace_op_names[op],
+                   (unsigned long long) h.count(), (unsigned long long) h.percentile(0.5),
+                   (unsigned long long) h.percentile(0.99), (unsigned long long) h.percentile(0.999),
+                   (unsigned long long) h.max());
+        }
+        if (!has_reference) {
+            reference = best->checksum;
+            has_reference = true;
+        } else if (best->checksum != reference) {
+            printf("warning: checksum differs from the first backend\n");
+        }
+    });
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) usage();
+    std::string mode = argv[1];
+    if (mode == "record-test7") return record_test7(argc, argv);
+    if (mode == "info") return info(argc, argv);
+    if (mode == "check") return check(argc, argv);
+    if (mode == "replay") return replay_all(argc, argv);
+    usage();
+}